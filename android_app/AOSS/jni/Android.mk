@@ -7,7 +7,7 @@ OPENCV_CAMERA_MODULES:=off
 include ../OpenCV-2.3.1/share/OpenCV/OpenCV.mk
 
 LOCAL_MODULE    := aoss_jni
-LOCAL_SRC_FILES := jni_part.cpp
+LOCAL_SRC_FILES := jni_part.cpp aoss_session.cpp
 LOCAL_LDLIBS +=  -llog -ldl
 
 include $(BUILD_SHARED_LIBRARY)
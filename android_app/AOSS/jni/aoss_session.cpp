@@ -0,0 +1,278 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// AOSS - Marco Lancini (www.marcolancini.it)
+//
+//
+// Copyright (C) 2012 Marco Lancini
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <vector>
+#include <cmath>
+
+#include "aoss_session.hpp"
+
+using namespace std;
+using namespace cv;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// CONSTANTS ///////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+const int threshold_value  = 45;
+const int max_BINARY_value = 255;
+const int erosion_size = 3;
+const int dilation_size = 3;
+const float thresh_area = 1;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// SKIN DETECTION //////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+void skinPixels( Mat *imgBGR, Mat *imgSkin, Mat *imgHSV, vector<Mat> *hsv_planes, Mat *planeH, Mat *planeS, Mat *planeV )
+{
+	// Returns an image that is white in corrispondence of skin pixels, black elsewhere
+
+    // Convert the image to HSV colors
+	*imgHSV = Mat::zeros( imgBGR->size(), CV_8UC3 );
+	cvtColor( *imgBGR, *imgHSV, CV_BGR2HSV );
+
+	// Get the separate HSV color components of the color input image
+	split( *imgHSV, *hsv_planes );
+
+	*planeH = hsv_planes->at(0);      // Hue component
+	*planeS = hsv_planes->at(1);      // Saturation component
+	*planeV = hsv_planes->at(2);      // Brightness component
+
+    // Detect which pixels in each of the H, S and V channels are probably skin pixels
+    // Assume that skin has a Hue between 0 to 18 (out of 180), and Saturation above 50, and Brightness above 80
+    threshold( *planeH, *planeH, 18, 255, THRESH_BINARY_INV );
+    threshold( *planeS, *planeS, 50, 255, THRESH_BINARY_INV );
+    threshold( *planeV, *planeV, 80, 255, THRESH_BINARY_INV );
+
+    // Combine all 3 thresholded color components
+    // so that an output pixel will only be white if the H, S and V pixels were also white
+    *imgSkin = Mat::zeros( imgHSV->size(), CV_8UC1 );  // Greyscale output image
+    bitwise_and( *planeH, *planeS, *imgSkin );		   // imageSkin = H {BITWISE_AND} S
+    bitwise_and( *imgSkin, *planeV, *imgSkin );		   // imageSkin = H {BITWISE_AND} S {BITWISE_AND} V
+
+    bitwise_not( *imgSkin, *imgSkin );
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// SELECT BIGGEST //////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+void selectBiggest( int *firstidx, int *secondidx, vector<Moments> *mu )
+{
+	// Returns the indexes of the 2 biggest contours of the image
+
+	*firstidx  = -1;
+	*secondidx = -1;
+
+	float firstdim  = -1;
+	float seconddim = -1;
+	float temparea;
+
+	// Init ////////////////////////////////////////////////////////////////////
+	if( mu->at(0).m00 > mu->at(1).m00 )
+	{
+		*firstidx = 0;
+		firstdim = mu->at(0).m00;
+
+		*secondidx = 1;
+		seconddim = mu->at(1).m00;;
+	}
+	else
+	{
+		*firstidx = 1;
+		firstdim = mu->at(1).m00;
+
+		*secondidx = 0;
+		seconddim = mu->at(0).m00;
+	}
+
+	// Iterate /////////////////////////////////////////////////////////////////
+	for( size_t i = 2; i < mu->size(); i++ )
+	{
+		temparea = mu->at(i).m00;
+
+		if( temparea > firstdim ) {
+			*secondidx = *firstidx;
+			seconddim = firstdim;
+
+			*firstidx = (int)i;
+			firstdim = temparea;
+		}
+		else if( temparea > seconddim ) {
+			*secondidx = (int)i;
+			seconddim = temparea;
+		}
+	}
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// SESSION /////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+AnalysisSession::AnalysisSession( int width, int height )
+	: frameWidth(width), frameHeight(height), submitted(0), pending(false), stopping(false)
+{
+	pthread_mutex_init( &lock, NULL );
+	pthread_cond_init( &wake, NULL );
+	pthread_create( &worker, NULL, workerMain, this );
+}
+
+AnalysisSession::~AnalysisSession()
+{
+	pthread_mutex_lock( &lock );
+	stopping = true;
+	pthread_cond_signal( &wake );
+	pthread_mutex_unlock( &lock );
+
+	pthread_join( worker, NULL );
+	pthread_cond_destroy( &wake );
+	pthread_mutex_destroy( &lock );
+}
+
+void AnalysisSession::submit( const unsigned char *yuv, int length )
+{
+	// Fill the free input slot; a frame the worker has not picked up yet is replaced
+	Frame &slot = frames.writeSlot();
+	slot.yuv.assign( yuv, yuv + length );
+	slot.seq = ++submitted;
+	frames.publish();
+
+	pthread_mutex_lock( &lock );
+	pending = true;
+	pthread_cond_signal( &wake );
+	pthread_mutex_unlock( &lock );
+}
+
+bool AnalysisSession::latest( SessionResult *out )
+{
+	bool fresh = results.update();
+	*out = results.readSlot();
+	return fresh;
+}
+
+void* AnalysisSession::workerMain( void *arg )
+{
+	((AnalysisSession*)arg)->loop();
+	return NULL;
+}
+
+void AnalysisSession::loop()
+{
+	for( ;; )
+	{
+		pthread_mutex_lock( &lock );
+		while( !pending && !stopping ) pthread_cond_wait( &wake, &lock );
+		bool stop = stopping;
+		pending = false;
+		pthread_mutex_unlock( &lock );
+
+		if( stop ) break;
+		if( !frames.update() ) continue;
+
+		analyze( &frames.readSlot(), &results.writeSlot() );
+		results.publish();
+	}
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// ANALYSIS ////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+void AnalysisSession::analyze( const Frame *frame, SessionResult *result )
+{
+	int firstidx, secondidx;
+	float area;
+
+	result->frame = frame->seq;
+	result->valid = 0;
+	result->p1x = result->p1y = result->p2x = result->p2y = 0;
+	result->distance = 0;
+
+	if( (int)frame->yuv.size() < frameWidth * ( frameHeight + frameHeight / 2 ) ) return;
+
+	// The Y plane is the gray image, the whole buffer converts to RGBA as in AOSSView
+	Mat yuv( frameHeight + frameHeight / 2, frameWidth, CV_8UC1, (void*)&frame->yuv[0] );
+	cvtColor( yuv, rgba, CV_YUV420sp2RGB, 4 );
+
+	// Blur ////////////////////////////////////////////////////////////////////
+	blur( yuv.rowRange( 0, frameHeight ), gray, Size(3,3) );
+
+	// Threshold ///////////////////////////////////////////////////////////////
+	threshold( gray, gray, threshold_value, max_BINARY_value, THRESH_BINARY_INV );
+
+	// Skin detection and subtraction //////////////////////////////////////////
+	skinPixels( &rgba, &imgSkin, &imgHSV, &hsv_planes, &planeH, &planeS, &planeV );
+	subtract( gray, imgSkin, gray );
+
+	// Erode ///////////////////////////////////////////////////////////////////
+	el1 = getStructuringElement( MORPH_RECT, Size( 2*erosion_size + 1, 2*erosion_size+1 ), Point( erosion_size, erosion_size ) );
+	erode( gray, gray, el1 );
+
+	// Dilate //////////////////////////////////////////////////////////////////
+	el2 = getStructuringElement( MORPH_RECT, Size( 2*dilation_size + 1, 2*dilation_size+1 ), Point( dilation_size, dilation_size ) );
+	dilate( gray, gray, el2 );
+
+	// Find contours ///////////////////////////////////////////////////////////
+	vector<vector<Point> > contours;
+	vector<Vec4i> hierarchy;
+	findContours( gray, contours, hierarchy, CV_RETR_TREE, CV_CHAIN_APPROX_SIMPLE, Point(0, 0) );
+
+	// selectBiggest() needs at least 2 contours
+	if( contours.size() < 2 ) return;
+
+	// ApproxPoly + Moments ////////////////////////////////////////////////////
+	vector<vector<Point> > contours_poly( contours.size() );
+	vector<Moments> mu( contours.size() );
+
+	for( size_t i = 0; i < contours.size(); i++ )
+	{
+		// Discard contours with area < threshold
+		area = contourArea( contours[i] );
+		if( area > thresh_area )
+		{
+			approxPolyDP( Mat(contours[i]), contours_poly[i], 3, true );
+			mu[i] = moments( contours_poly[i], false );
+		}
+	}
+
+	// Select 2 contours, whose moments have the biggest area //////////////////
+	selectBiggest( &firstidx, &secondidx, &mu );
+	if( mu[firstidx].m00 == 0 || mu[secondidx].m00 == 0 ) return;
+
+	result->p1x = mu[firstidx].m10/mu[firstidx].m00;
+	result->p1y = mu[firstidx].m01/mu[firstidx].m00;
+	result->p2x = mu[secondidx].m10/mu[secondidx].m00;
+	result->p2y = mu[secondidx].m01/mu[secondidx].m00;
+
+	result->distance = sqrt( pow( (double)( result->p1x - result->p2x ), 2 ) + pow( (double)( result->p1y - result->p2y ), 2 ) );
+	result->valid = 1;
+}
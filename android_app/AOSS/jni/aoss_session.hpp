@@ -0,0 +1,105 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// AOSS - Marco Lancini (www.marcolancini.it)
+//
+//
+// Copyright (C) 2012 Marco Lancini
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef AOSS_SESSION_HPP
+#define AOSS_SESSION_HPP
+
+#include <pthread.h>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "triple_buffer.hpp"
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// SESSION /////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Outcome of the analysis of one frame
+struct SessionResult
+{
+	long long frame;                // Sequence number of the analyzed frame
+	int valid;                      // 0 if fewer than 2 objects were found
+	int p1x, p1y;                   // Centers of the 2 biggest objects
+	int p2x, p2y;
+	double distance;
+};
+
+// Native side of the camera view, created once per preview size.
+// submit() copies the YUV420sp frame and returns at once; a worker thread
+// always analyzes the newest submitted frame, dropping the ones it could not
+// keep up with, and publishes the result. Frames and results are handed over
+// through triple buffers, so neither the camera nor the UI thread ever waits
+// for the analysis. Nothing here depends on the JVM.
+class AnalysisSession
+{
+public:
+	AnalysisSession( int width, int height );
+	~AnalysisSession();
+
+	// Camera thread
+	void submit( const unsigned char *yuv, int length );
+
+	// UI thread: copies the newest result, returns true if it was not read before
+	bool latest( SessionResult *out );
+
+	int width() const  { return frameWidth; }
+	int height() const { return frameHeight; }
+
+private:
+	struct Frame
+	{
+		std::vector<unsigned char> yuv;
+		long long seq;
+	};
+
+	int frameWidth, frameHeight;
+	long long submitted;
+
+	TripleBuffer<Frame> frames;
+	TripleBuffer<SessionResult> results;
+
+	pthread_t worker;
+	pthread_mutex_t lock;           // Guards pending and stopping only
+	pthread_cond_t wake;
+	bool pending;
+	bool stopping;
+
+	// Working images, owned by the worker
+	cv::Mat gray, rgba, imgHSV, imgSkin, planeH, planeS, planeV, el1, el2;
+	std::vector<cv::Mat> hsv_planes;
+
+	static void* workerMain( void *arg );
+	void loop();
+	void analyze( const Frame *frame, SessionResult *result );
+
+	AnalysisSession( const AnalysisSession& );
+	AnalysisSession& operator=( const AnalysisSession& );
+};
+
+#endif
@@ -0,0 +1,273 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// AOSS - Marco Lancini (www.marcolancini.it)
+//
+//
+// Copyright (C) 2012 Marco Lancini
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "aoss_session.hpp"
+#include "triple_buffer.hpp"
+
+using namespace std;
+
+
+// Desktop check of the native part, without the JVM or a device:
+//
+//     g++ -O2 -pthread session_check.cpp aoss_session.cpp -o session_check `pkg-config --cflags --libs opencv`
+//
+// Exits with 0 when every check passes.
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// HELPERS /////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+static int failures = 0;
+
+static void check( bool ok, const char *what )
+{
+	printf( "%s  %s\n", ok ? "ok  " : "FAIL", what );
+	if( !ok ) failures++;
+}
+
+static double now()
+{
+	timeval tv;
+	gettimeofday( &tv, NULL );
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// TRIPLE BUFFER ///////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Every field of a published value holds its sequence number, so a value
+// mixing two writes shows up as fields that differ
+struct Stamp
+{
+	long long seq;
+	long long copy[15];
+};
+
+struct StampWriter
+{
+	TripleBuffer<Stamp> *buffer;
+	long long count;
+	volatile bool started, done;
+};
+
+static void* writeStamps( void *arg )
+{
+	StampWriter *w = (StampWriter*)arg;
+	while( !w->started ) {}
+	for( long long seq = 1; seq <= w->count; seq++ )
+	{
+		// Now and then the writer gives way halfway through a value, so the
+		// reader also runs while a slot is being filled, on a single core too
+		Stamp &s = w->buffer->writeSlot();
+		s.seq = seq;
+		for( int i = 0; i < 15; i++ )
+		{
+			s.copy[i] = seq;
+			if( i == 7 && seq % 64 == 0 ) sched_yield();
+		}
+		w->buffer->publish();
+	}
+	__sync_synchronize();
+	w->done = true;
+	return NULL;
+}
+
+static void checkTripleBuffer()
+{
+	// One writer publishes increasing values as fast as it can; the reader
+	// must only ever see whole values, each newer than the one before
+
+	TripleBuffer<Stamp> buffer;
+	StampWriter w = { &buffer, 200000, false, false };
+	pthread_t writer;
+	pthread_create( &writer, NULL, writeStamps, &w );
+	w.started = true;
+
+	long long last = 0, reads = 0;
+	bool torn = false, older = false, stale = false;
+	for( bool finished = false; !finished; )
+	{
+		finished = w.done;
+		bool fresh = buffer.update();
+		const Stamp &s = buffer.readSlot();
+
+		for( int i = 0; i < 15; i++ ) torn = torn || s.copy[i] != s.seq;
+		if( fresh ) older = older || s.seq <= last;
+		else        stale = stale || s.seq != last;
+		last = s.seq;
+		reads += fresh;
+	}
+	pthread_join( writer, NULL );
+
+	// The last value is always delivered
+	buffer.update();
+	last = buffer.readSlot().seq;
+
+	printf( "      triple buffer: %lld of %lld values read\n", reads, w.count );
+	check( !torn, "triple buffer: no value mixes two writes" );
+	check( !older, "triple buffer: every fresh value is newer than the previous one" );
+	check( !stale, "triple buffer: without a fresh value the slot is unchanged" );
+	check( last == w.count, "triple buffer: the last value published is read" );
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// SESSION /////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+const int width = 320, height = 240;
+
+// Dark objects on the white table, in the Y plane of a YUV420sp frame
+struct Box { int x0, y0, x1, y1; };
+const Box leftBox  = {  40,  60,  99, 139 };
+const Box rightBox = { 200, 100, 279, 169 };
+
+static void makeFrame( vector<unsigned char> *yuv, const Box *boxes, int n )
+{
+	yuv->assign( width * height * 3 / 2, 128 );      // Gray chroma
+	for( int y = 0; y < height; y++ )
+		for( int x = 0; x < width; x++ )
+		{
+			bool dark = false;
+			for( int i = 0; i < n; i++ )
+				dark = dark || ( x >= boxes[i].x0 && x <= boxes[i].x1 && y >= boxes[i].y0 && y <= boxes[i].y1 );
+			(*yuv)[ y * width + x ] = dark ? 16 : 235;
+		}
+}
+
+static bool near( int px, int py, const Box &b )
+{
+	return abs( 2 * px - ( b.x0 + b.x1 ) ) <= 4 && abs( 2 * py - ( b.y0 + b.y1 ) ) <= 4;
+}
+
+static bool matches( const SessionResult &r )
+{
+	// The two boxes, in either order, within 2 pixels
+	return ( near( r.p1x, r.p1y, leftBox ) && near( r.p2x, r.p2y, rightBox ) ) ||
+		   ( near( r.p1x, r.p1y, rightBox ) && near( r.p2x, r.p2y, leftBox ) );
+}
+
+// Frames 1..perPhase show both boxes, the following ones only the leftBox box
+struct Camera
+{
+	AnalysisSession *session;
+	int perPhase;
+	vector<unsigned char> two, one;
+};
+
+static void* runCamera( void *arg )
+{
+	Camera *c = (Camera*)arg;
+	for( int i = 1; i <= 2 * c->perPhase; i++ )
+	{
+		const vector<unsigned char> &f = ( i <= c->perPhase ) ? c->two : c->one;
+		c->session->submit( &f[0], (int)f.size() );
+		usleep( 2000 );
+	}
+	return NULL;
+}
+
+static void checkSession()
+{
+	// A camera thread submits frames while this thread, as the UI would,
+	// polls the newest result
+
+	AnalysisSession session( width, height );
+
+	Camera camera;
+	camera.session = &session;
+	camera.perPhase = 100;
+	Box both[2] = { leftBox, rightBox };
+	makeFrame( &camera.two, both, 2 );
+	makeFrame( &camera.one, &leftBox, 1 );
+
+	pthread_t thread;
+	pthread_create( &thread, NULL, runCamera, &camera );
+
+	long long last = 0;
+	int fresh = 0, wrongTwo = 0, wrongOne = 0, seenTwo = 0, seenOne = 0;
+	bool older = false;
+	double deadline = now() + 30;
+	while( last < 2 * camera.perPhase && now() < deadline )
+	{
+		SessionResult r;
+		if( !session.latest( &r ) )
+		{
+			usleep( 500 );
+			continue;
+		}
+
+		fresh++;
+		older = older || r.frame <= last;
+		last = r.frame;
+		if( r.frame <= camera.perPhase )
+		{
+			seenTwo++;
+			if( !r.valid || !matches( r ) ) wrongTwo++;
+		}
+		else
+		{
+			seenOne++;
+			if( r.valid ) wrongOne++;
+		}
+	}
+	pthread_join( thread, NULL );
+
+	printf( "      session: %d results for %d frames\n", fresh, 2 * camera.perPhase );
+	check( last == 2 * camera.perPhase, "session: the last frame submitted is analyzed" );
+	check( !older, "session: results come in frame order" );
+	check( seenTwo > 0 && wrongTwo == 0, "session: two dark boxes give their centers" );
+	check( seenOne > 0 && wrongOne == 0, "session: a single box gives no result" );
+	SessionResult again;
+	check( !session.latest( &again ) && again.frame == last, "session: a result is fresh only once" );
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// MAIN ////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+int main()
+{
+	checkTripleBuffer();
+	checkSession();
+
+	if( failures ) printf( "%d checks failed\n", failures );
+	else           printf( "All checks passed\n" );
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,76 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// AOSS - Marco Lancini (www.marcolancini.it)
+//
+//
+// Copyright (C) 2012 Marco Lancini
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef AOSS_TRIPLE_BUFFER_HPP
+#define AOSS_TRIPLE_BUFFER_HPP
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// TRIPLE BUFFER ///////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Lock-free handoff of the newest value from one writer thread to one reader
+// thread. The writer fills its own slot and swaps it with the middle one; the
+// reader swaps its slot with the middle one only if something new was
+// published. Neither side ever waits, and older values are simply overwritten.
+template<class T>
+class TripleBuffer
+{
+public:
+	TripleBuffer() : slots(), back(0), front(1), state(2) {}
+
+	// Writer side
+	T&   writeSlot() { return slots[back]; }
+	void publish()   { back = exchange( back | FRESH ) & INDEX; }
+
+	// Reader side: returns true if readSlot() now holds a newer value
+	bool update()
+	{
+		if( !( state & FRESH ) ) return false;
+		front = exchange( front ) & INDEX;
+		return true;
+	}
+	const T& readSlot() const { return slots[front]; }
+
+private:
+	enum { INDEX = 3, FRESH = 4 };
+
+	T slots[3];
+	int back;                   // Owned by the writer
+	int front;                  // Owned by the reader
+	volatile int state;         // Middle slot index, plus FRESH when unread
+
+	int exchange( int value )
+	{
+		// Full barrier, available on every GCC the NDK ships
+		int old;
+		do { old = state; } while( !__sync_bool_compare_and_swap( &state, old, value ) );
+		return old;
+	}
+};
+
+#endif
@@ -27,8 +27,11 @@
 package org.opencv.aoss;
 
 import org.opencv.android.Utils;
+import org.opencv.core.Core;
 import org.opencv.core.Mat;
 import org.opencv.core.CvType;
+import org.opencv.core.Point;
+import org.opencv.core.Scalar;
 import org.opencv.imgproc.Imgproc;
 
 import android.content.Context;
@@ -41,18 +44,14 @@ import android.view.SurfaceHolder;
 class AOSSView extends AOSSViewBase {
     private Mat mYuv;
     private Mat mRgba;
-    private Mat mGraySubmat;
-
-    private Mat skin;
-    private Mat imgHSV;
-    private Mat planeH;
-    private Mat planeS;
-    private Mat planeV;
-    private Mat imgSkin;
-    private Mat el1;
-    private Mat el2;
-
-    private double distance;
+
+    // Handle of the native analysis session, 0 when there is none
+    private long mSession;
+
+    // Newest native result: { valid, p1x, p1y, p2x, p2y, distance }
+    private double[] mResult = new double[6];
+    private static final Scalar GREEN = new Scalar(0, 255, 0);
+
     private SoundSynt soundSynt;
     
     // Constructor + Instantiate the sound synthesizer
@@ -70,19 +69,12 @@ class AOSSView extends AOSSViewBase {
             // Original frame in YUV    
             mYuv = new Mat(getFrameHeight() + getFrameHeight() / 2, getFrameWidth(), CvType.CV_8UC1);
 
-            // Gray image from subsampling the original one
-            mGraySubmat = mYuv.submat(0, getFrameHeight(), 0, getFrameWidth());
-
-            // Matrices needed by the CV module
-            mRgba   = new Mat();
-            skin    = new Mat();
-            imgHSV  = new Mat();
-            planeH  = new Mat();
-            planeS  = new Mat();
-            planeV  = new Mat();
-            imgSkin = new Mat();
-            el1     = new Mat();
-            el2     = new Mat();   
+            mRgba = new Mat();
+
+            // Native session for the new frame size; it owns the CV module buffers
+            if (mSession != 0) destroySession(mSession);
+            mSession = createSession(getFrameWidth(), getFrameHeight());
+            mResult[0] = 0;
         }
     }
 
@@ -106,29 +98,32 @@ class AOSSView extends AOSSViewBase {
             
         case AOSS.VIEW_MODE_FEATURES:
             // If the user choose to start AOSS functionalities,
-            //      then process each frame calling the JNI native interfaces
-            //      and use the distance returned from JNI to update the 
-            //      frequence of the sound synthesizer
+            //      then hand each frame to the native session, which analyzes
+            //      it on its own thread, and use the newest distance it
+            //      published to update the frequence of the sound synthesizer
 
             // Convert from YUV to RGB
             Imgproc.cvtColor(mYuv, mRgba, Imgproc.COLOR_YUV420sp2RGB, 4);
 
-            // Call native JNI
-            distance = analyzeFrame( 
-                                    mGraySubmat.getNativeObjAddr(),
-                                    mRgba.getNativeObjAddr(), 
-                                    skin.getNativeObjAddr(),
-                                    imgHSV.getNativeObjAddr(), 
-                                    planeH.getNativeObjAddr(),
-                                    planeS.getNativeObjAddr(), 
-                                    planeV.getNativeObjAddr(), 
-                                    imgSkin.getNativeObjAddr(), 
-                                    el1.getNativeObjAddr(),
-                                    el2.getNativeObjAddr() );
-            
-            // Use the new distance to update the sound
-            soundSynt.updateSound(distance);
-            
+            // Submit the frame to native JNI, returns at once
+            submitFrame(mSession, data);
+
+            // Update the sound only when a new result is available; mute it
+            //      when the objects were not found, since a distance of 0
+            //      would sound like objects touching
+            if (latestResult(mSession, mResult)) {
+                if (mResult[0] != 0)
+                    soundSynt.updateSound(mResult[5]);
+                else
+                    soundSynt.stopSound();
+            }
+
+            // Draw the tracked objects
+            if (mResult[0] != 0) {
+                Core.circle(mRgba, new Point(mResult[1], mResult[2]), 5, GREEN, -1);
+                Core.circle(mRgba, new Point(mResult[3], mResult[4]), 5, GREEN, -1);
+            }
+
             break;
         }
 
@@ -149,34 +144,19 @@ class AOSSView extends AOSSViewBase {
         synchronized (this) {    
             if (mYuv != null) mYuv.release();
             if (mRgba != null) mRgba.release();
-            if (mGraySubmat != null) mGraySubmat.release();
-            if (skin != null) skin.release();
-            if (imgHSV != null) imgHSV.release();
-            if (planeH != null) planeH.release();
-            if (planeS != null) planeS.release();
-            if (planeV != null) planeV.release();
-            if (imgSkin != null) imgSkin.release();
-            if (el1 != null) el1.release();
-            if (el2 != null) el2.release();
-            
-            mYuv        = null;
-            mRgba       = null;
-            mGraySubmat = null;
-            skin        = null;
-            imgHSV      = null;
-            planeH      = null;
-            planeS      = null;
-            planeV      = null;
-            imgSkin     = null;
-            el1         = null;
-            el2         = null;
+            if (mSession != 0) destroySession(mSession);
+
+            mYuv     = null;
+            mRgba    = null;
+            mSession = 0;
         }
     }
 
-    // Prototype of the native function
-    public native double analyzeFrame( long mGraySubmat, long mRgba, 
-    								 long skin, long imgHSV, 
-    								 long planeH, long planeS, long planeV, long imgSkin, long el1, long el2 );
+    // Prototypes of the native functions
+    public native long createSession(int width, int height);
+    public native void destroySession(long session);
+    public native void submitFrame(long session, byte[] data);
+    public native boolean latestResult(long session, double[] result);
     
     // Load the native module
     static {
@@ -0,0 +1,262 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// AOSS Vision Module - Marco Lancini (www.marcolancini.it)
+//
+//
+// Copyright (C) 2012 Marco Lancini
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include <opencv2/core/core.hpp>
+
+#include "AOSS_Analyzer.hpp"
+#include "AOSS_Blobs.hpp"
+#include "AOSS_Kernels.hpp"
+#include "AOSS_Scanline.hpp"
+#include "AOSS_Objects.hpp"
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// WORKERS /////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+struct Analyzer::Worker
+{
+	ScanlinePipeline pipeline;
+	cv::Mat mask;
+	std::vector<Blob> blobs;
+	std::vector<double> areas;
+	std::vector<int> top;
+
+	explicit Worker( const AnalyzerConfig &cfg )
+		: pipeline( cfg.thresh, cfg.erosion, cfg.dilation )
+	{
+		pipeline.maxH = cfg.maxH;
+		pipeline.maxS = cfg.maxS;
+		pipeline.maxV = cfg.maxV;
+	}
+};
+
+Analyzer::Analyzer( const AnalyzerConfig &config )
+	: cfg(config), inFlight(0), stopping(false), nSubmitted(0), nAnalyzed(0), nDropped(0)
+{
+	cfg.workers  = std::max( 1, cfg.workers );
+	cfg.capacity = std::max( cfg.workers, cfg.capacity );
+	cfg.maxObjects = std::max( 2, cfg.maxObjects );
+
+	// Pick the pixel kernels before the workers race to do it
+	kernels();
+
+	for( int i = 0; i < cfg.workers; i++ )
+		workers.push_back( new Worker( cfg ) );
+	for( int i = 0; i < cfg.workers; i++ )
+		threads.push_back( std::thread( &Analyzer::workerLoop, this, workers[i] ) );
+}
+
+Analyzer::~Analyzer()
+{
+	{
+		std::lock_guard<std::mutex> guard( lock );
+		stopping = true;
+	}
+	notEmpty.notify_all();
+
+	for( size_t i = 0; i < threads.size(); i++ ) threads[i].join();
+	for( size_t i = 0; i < workers.size(); i++ ) delete workers[i];
+}
+
+void Analyzer::workerLoop( Worker *worker )
+{
+	for( ;; )
+	{
+		Job job;
+		{
+			std::unique_lock<std::mutex> guard( lock );
+			while( queue.empty() && !stopping ) notEmpty.wait( guard );
+			if( queue.empty() ) return;
+
+			job = std::move( queue.front() );
+			queue.pop_front();
+		}
+
+		AnalyzerResult result;
+		analyze( worker, &job, &result );
+		nAnalyzed++;
+
+		// Release the frame before the slot, so capacity bounds the frames alive
+		job.frame.release();
+		{
+			std::lock_guard<std::mutex> guard( lock );
+			inFlight--;
+		}
+		notFull.notify_one();
+
+		finish( &job, result );
+	}
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// SUBMIT //////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+std::future<AnalyzerResult> Analyzer::submit( const cv::Mat &frame, int64_t timestamp )
+{
+	Job job;
+	job.frame = frame;
+	job.timestamp = timestamp;
+	std::future<AnalyzerResult> future = job.promise.get_future();
+
+	enqueue( &job );
+	return future;
+}
+
+bool Analyzer::submit( const cv::Mat &frame, int64_t timestamp, Callback callback )
+{
+	Job job;
+	job.frame = frame;
+	job.timestamp = timestamp;
+	job.callback = std::move( callback );
+
+	return enqueue( &job );
+}
+
+bool Analyzer::enqueue( Job *job )
+{
+	// Takes the job if there is room; otherwise the policy decides which frame
+	// is dropped. Dropped jobs are completed after the lock is released.
+
+	Job victim;
+	bool accepted = true, evicted = false;
+	nSubmitted++;
+	{
+		std::unique_lock<std::mutex> guard( lock );
+
+		if( cfg.policy == BACKPRESSURE_BLOCK )
+			while( inFlight >= cfg.capacity ) notFull.wait( guard );
+
+		if( inFlight >= cfg.capacity )
+		{
+			if( cfg.policy == BACKPRESSURE_DROP_OLDEST && !queue.empty() )
+			{
+				// The slot of the oldest queued frame goes to the new one
+				victim = std::move( queue.front() );
+				queue.pop_front();
+				inFlight--;
+				evicted = true;
+			}
+			else accepted = false;     // Every slot is being analyzed
+		}
+
+		if( accepted )
+		{
+			queue.push_back( std::move( *job ) );
+			inFlight++;
+		}
+	}
+
+	if( accepted ) notEmpty.notify_one();
+
+	AnalyzerResult dropped;
+	dropped.status = ANALYZER_DROPPED;
+	if( evicted )
+	{
+		nDropped++;
+		dropped.timestamp = victim.timestamp;
+		finish( &victim, dropped );
+	}
+	if( !accepted )
+	{
+		nDropped++;
+		dropped.timestamp = job->timestamp;
+		finish( job, dropped );
+	}
+	return accepted;
+}
+
+void Analyzer::finish( Job *job, const AnalyzerResult &result )
+{
+	if( job->callback ) job->callback( result );
+	else job->promise.set_value( result );
+}
+
+AnalyzerStats Analyzer::stats() const
+{
+	AnalyzerStats s;
+	s.submitted = nSubmitted;
+	s.analyzed  = nAnalyzed;
+	s.dropped   = nDropped;
+	return s;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// ANALYSIS ////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+void Analyzer::analyze( Worker *worker, Job *job, AnalyzerResult *result )
+{
+	// Same chain as the stream mode of the vision module, then the biggest blobs
+
+	result->timestamp = job->timestamp;
+	if( job->frame.empty() || job->frame.type() != CV_8UC3 )
+	{
+		result->status = ANALYZER_INVALID;
+		return;
+	}
+
+	worker->pipeline.run( &job->frame, &worker->mask, NULL, &worker->blobs );
+
+	// Areas of the objects that count, 0 for the others
+	worker->areas.resize( worker->blobs.size() );
+	for( size_t i = 0; i < worker->blobs.size(); i++ )
+	{
+		double a = worker->blobs[i].m00;
+		worker->areas[i] = ( a > cfg.minArea ) ? a : 0;
+		if( a > cfg.minArea ) result->objects++;
+	}
+
+	selectTopK( &worker->areas, cfg.maxObjects, &worker->top );
+	for( size_t i = 0; i < worker->top.size(); i++ )
+	{
+		const Blob &b = worker->blobs[ worker->top[i] ];
+		result->centers.push_back( b.center() );
+		result->boxes.push_back( b.box() );
+		result->areas.push_back( b.m00 );
+	}
+	result->pairs.compute( &result->centers );
+
+	if( result->centers.size() >= 1 )
+	{
+		result->p1   = result->centers[0];
+		result->box1 = result->boxes[0];
+	}
+	if( result->centers.size() >= 2 )
+	{
+		result->p2   = result->centers[1];
+		result->box2 = result->boxes[1];
+		result->distance = std::sqrt( ( result->p1.x - result->p2.x ) * ( result->p1.x - result->p2.x ) +
+									  ( result->p1.y - result->p2.y ) * ( result->p1.y - result->p2.y ) );
+	}
+}
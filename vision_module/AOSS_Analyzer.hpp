@@ -0,0 +1,167 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// AOSS Vision Module - Marco Lancini (www.marcolancini.it)
+//
+//
+// Copyright (C) 2012 Marco Lancini
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef AOSS_ANALYZER_HPP
+#define AOSS_ANALYZER_HPP
+
+#include <vector>
+#include <deque>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+#include <stdint.h>
+
+#include <opencv2/core/core.hpp>
+
+#include "AOSS_Objects.hpp"
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// LIBAOSS_VISION //////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Embeddable version of the detector: frames go in from any number of
+// threads, a pool of workers runs the fused scanline pipeline on them and the
+// biggest objects, with the distance between every pair of them, come back
+// through a future or a callback. Built as
+// libaoss_vision from AOSS_Analyzer.cpp, see the README.
+
+enum AnalyzerStatus
+{
+	ANALYZER_DONE,                  // Frame analyzed
+	ANALYZER_DROPPED,               // Discarded by the backpressure policy
+	ANALYZER_INVALID                // Not an 8-bit BGR image
+};
+
+enum Backpressure
+{
+	BACKPRESSURE_BLOCK,             // submit() waits for a free slot
+	BACKPRESSURE_REJECT,            // The new frame is dropped
+	BACKPRESSURE_DROP_OLDEST        // The oldest queued frame is dropped
+};
+
+struct AnalyzerConfig
+{
+	int workers;                    // Analysis threads
+	int capacity;                   // Frames queued or being analyzed, at most
+	Backpressure policy;
+
+	int thresh;                     // Dark threshold (inverted binary)
+	int maxH, maxS, maxV;           // Skin limits
+	int erosion, dilation;          // Radii of the rectangular kernels
+	float minArea;                  // Smaller objects are ignored
+	int maxObjects;                 // Biggest objects reported, at least 2
+
+	AnalyzerConfig()
+		: workers(1), capacity(8), policy(BACKPRESSURE_BLOCK),
+		  thresh(45), maxH(18), maxS(50), maxV(80), erosion(3), dilation(3), minArea(500), maxObjects(2) {}
+};
+
+struct AnalyzerResult
+{
+	AnalyzerStatus status;
+	int64_t timestamp;              // As given to submit()
+	int objects;                    // Objects bigger than minArea
+	cv::Point2f p1, p2;             // Centers of the 2 biggest, valid if objects >= 2
+	cv::Rect box1, box2;
+	double distance;
+
+	// The biggest maxObjects objects, biggest first, and their distances
+	std::vector<cv::Point2f> centers;
+	std::vector<cv::Rect> boxes;
+	std::vector<double> areas;
+	PairwiseDistances pairs;
+
+	AnalyzerResult() : status(ANALYZER_DONE), timestamp(0), objects(0), distance(0) {}
+};
+
+struct AnalyzerStats
+{
+	uint64_t submitted;
+	uint64_t analyzed;
+	uint64_t dropped;
+};
+
+class Analyzer
+{
+public:
+	typedef std::function<void( const AnalyzerResult& )> Callback;
+
+	explicit Analyzer( const AnalyzerConfig &config = AnalyzerConfig() );
+
+	// Frames still queued are analyzed before the workers stop
+	~Analyzer();
+
+	// The frame is shared, not copied: a caller that reuses its buffer (as
+	// VideoCapture does) must pass a clone. Both calls are thread safe.
+	std::future<AnalyzerResult> submit( const cv::Mat &frame, int64_t timestamp );
+
+	// The callback runs on a worker thread, or on the submitting thread when
+	// the frame is dropped; returns false if the frame was dropped
+	bool submit( const cv::Mat &frame, int64_t timestamp, Callback callback );
+
+	AnalyzerStats stats() const;
+
+	const AnalyzerConfig& config() const { return cfg; }
+
+private:
+	struct Job
+	{
+		cv::Mat frame;
+		int64_t timestamp;
+		std::promise<AnalyzerResult> promise;
+		Callback callback;              // Used instead of the promise when set
+	};
+
+	struct Worker;                      // Pipeline and scratch buffers of one thread
+
+	AnalyzerConfig cfg;
+
+	std::mutex lock;
+	std::condition_variable notEmpty, notFull;
+	std::deque<Job> queue;
+	int inFlight;                       // Queued + being analyzed
+	bool stopping;
+
+	std::vector<std::thread> threads;
+	std::vector<Worker*> workers;
+
+	std::atomic<uint64_t> nSubmitted, nAnalyzed, nDropped;
+
+	bool enqueue( Job *job );
+	void workerLoop( Worker *worker );
+	void analyze( Worker *worker, Job *job, AnalyzerResult *result );
+	static void finish( Job *job, const AnalyzerResult &result );
+
+	Analyzer( const Analyzer& );
+	Analyzer& operator=( const Analyzer& );
+};
+
+#endif
@@ -0,0 +1,128 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// AOSS Vision Module - Marco Lancini (www.marcolancini.it)
+//
+//
+// Copyright (C) 2012 Marco Lancini
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef AOSS_BAR_CHART_HPP
+#define AOSS_BAR_CHART_HPP
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// BAR CHART ///////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Bar chart drawn in two layers. The background (axis and labels, the
+// expensive Hershey text) is rendered once for each chart height; every
+// frame only the bars whose value changed are wiped, by copying the
+// background back over their old rectangle, and filled again.
+class BarChart
+{
+public:
+	explicit BarChart( int width_ ) : width(width_), height(-1) {}
+
+	void addBar( int x, int barWidth, const cv::Scalar &color, const std::string &label )
+	{
+		Bar b = { x, barWidth, color, label, 0 };
+		bars.push_back( b );
+		height = -1;
+	}
+
+	bool empty() const { return bars.empty(); }
+
+	// Draws values[i] for each bar on a chart `axis` pixels high (plus the labels)
+	void draw( cv::Mat *chart, int axis, const int *values )
+	{
+		if( axis != height || chart->rows != axis + 50 || chart->cols != width )
+		{
+			buildBackground( axis );
+			background.copyTo( *chart );
+			for( size_t i = 0; i < bars.size(); i++ ) fillBar( chart, &bars[i], values[i] );
+			return;
+		}
+
+		for( size_t i = 0; i < bars.size(); i++ )
+		{
+			Bar *b = &bars[i];
+			if( b->value == values[i] ) continue;
+
+			cv::Rect dirty = barRect( b, b->value );
+			if( dirty.area() > 0 )
+			{
+				cv::Mat roi = (*chart)( dirty );
+				background( dirty ).copyTo( roi );
+			}
+			fillBar( chart, b, values[i] );
+		}
+	}
+
+private:
+	struct Bar
+	{
+		int x, width;
+		cv::Scalar color;
+		std::string label;
+		int value;                  // Currently drawn
+	};
+
+	int width, height;
+	std::vector<Bar> bars;
+	cv::Mat background;
+
+	void buildBackground( int axis )
+	{
+		height = axis;
+		background = cv::Mat::zeros( cv::Size( width, axis + 50 ), CV_8UC3 );
+
+		// Axis
+		cv::line( background, cv::Point( 0, axis ), cv::Point( width, axis ), cv::Scalar( 0, 0, 255 ), 5, 8, 0 );
+
+		// Labels
+		for( size_t i = 0; i < bars.size(); i++ )
+			cv::putText( background, bars[i].label, cv::Point( bars[i].x, axis + 30 ), cv::FONT_HERSHEY_TRIPLEX, 1, cv::Scalar( 255, 255, 255 ), 1, 8, false );
+	}
+
+	cv::Rect barRect( const Bar *b, int value ) const
+	{
+		// Pixels covered by rectangle( (x, axis), (x+width, axis-value), FILLED )
+		int y0 = std::min( height, height - value ), y1 = std::max( height, height - value );
+		cv::Rect r( b->x, y0, b->width + 1, y1 - y0 + 1 );
+		return r & cv::Rect( 0, 0, width, height + 50 );
+	}
+
+	void fillBar( cv::Mat *chart, Bar *b, int value )
+	{
+		cv::rectangle( *chart, cv::Point( b->x, height ), cv::Point( b->x + b->width, height - value ), b->color, CV_FILLED, 8, 0 );
+		b->value = value;
+	}
+};
+
+#endif
@@ -0,0 +1,781 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// AOSS Vision Module - Marco Lancini (www.marcolancini.it)
+//
+//
+// Copyright (C) 2012 Marco Lancini
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef AOSS_BENCHMARK_HPP
+#define AOSS_BENCHMARK_HPP
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "AOSS_Blobs.hpp"
+#include "AOSS_PackedMask.hpp"
+#include "AOSS_RleMask.hpp"
+#include "AOSS_Scanline.hpp"
+#include "AOSS_Tiles.hpp"
+#include "AOSS_Profiles.hpp"
+#include "AOSS_Kernels.hpp"
+#include "AOSS_Analyzer.hpp"
+#include "AOSS_BarChart.hpp"
+#include "AOSS_Objects.hpp"
+#include "AOSS_Tracker.hpp"
+#include "AOSS_FramePool.hpp"
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// SYNTHETIC INPUT /////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+inline void syntheticTable( cv::Mat *gray, cv::Size size, double density, cv::RNG *rng )
+{
+	// White table with dark discs until about `density` of the pixels are
+	// dark, plus a sprinkle of isolated dark pixels that the opening removes
+
+	*gray = cv::Mat( size, CV_8UC1, cv::Scalar(230) );
+	double total = (double)size.area();
+	double dark  = 0;
+
+	while( dark / total < density )
+	{
+		cv::Point c( rng->uniform( 0, size.width ), rng->uniform( 0, size.height ) );
+		int r = rng->uniform( 10, std::max( 11, size.height / 8 ) );
+		cv::circle( *gray, c, r, cv::Scalar(20), -1, 8, 0 );
+		dark = total - cv::countNonZero( *gray > 45 );
+	}
+
+	for( int i = 0; i < size.area() / 1000; i++ )
+		gray->at<uchar>( rng->uniform( 0, size.height ), rng->uniform( 0, size.width ) ) = 20;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// MASK MODES //////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+inline void benchMaskModes( cv::Size size, int iterations, int thresh, int erosion, int dilation )
+{
+	// Times threshold + erode + dilate + blob statistics for the dense, packed
+	// and RLE representations, on synthetic tables of increasing dark density
+
+	const double densities[] = { 0.001, 0.01, 0.05, 0.10, 0.25, 0.50 };
+	const int nDensities = sizeof(densities) / sizeof(densities[0]);
+
+	cv::RNG rng( 12345 );
+	cv::Mat gray, mask;
+	cv::Mat el1 = cv::getStructuringElement( cv::MORPH_RECT, cv::Size( 2*erosion + 1, 2*erosion + 1 ), cv::Point( erosion, erosion ) );
+	cv::Mat el2 = cv::getStructuringElement( cv::MORPH_RECT, cv::Size( 2*dilation + 1, 2*dilation + 1 ), cv::Point( dilation, dilation ) );
+
+	std::cout << "Mask modes, " << size.width << "x" << size.height << ", " << iterations << " iterations (ms per frame)" << std::endl;
+	std::cout << std::setw(10) << "density" << std::setw(10) << "runs"
+			  << std::setw(10) << "dense" << std::setw(10) << "packed" << std::setw(10) << "rle" << std::endl;
+
+	for( int d = 0; d < nDensities; d++ )
+	{
+		syntheticTable( &gray, size, densities[d], &rng );
+
+		std::vector<std::vector<cv::Point> > contours;
+		std::vector<cv::Vec4i> hierarchy;
+		std::vector<Blob> blobs;
+		std::vector<Run> runs;
+		std::vector<int> labels;
+		PackedMask p1, p2, p3;
+		RleMask r1, r2, r3;
+
+		// Dense
+		int64 t0 = cv::getTickCount();
+		for( int i = 0; i < iterations; i++ )
+		{
+			cv::threshold( gray, mask, thresh, 255, cv::THRESH_BINARY_INV );
+			cv::erode( mask, mask, el1 );
+			cv::dilate( mask, mask, el2 );
+			cv::findContours( mask, contours, hierarchy, CV_RETR_TREE, CV_CHAIN_APPROX_SIMPLE, cv::Point(0, 0) );
+			for( size_t c = 0; c < contours.size(); c++ ) cv::moments( contours[c], false );
+		}
+
+		// Packed
+		int64 t1 = cv::getTickCount();
+		for( int i = 0; i < iterations; i++ )
+		{
+			packThresholdInv( &gray, &p1, thresh );
+			packedMorph( &p1, &p2, erosion, true );
+			packedMorph( &p2, &p3, dilation, false );
+			labelPackedMask( &p3, &blobs, &runs, &labels );
+		}
+
+		// RLE
+		int64 t2 = cv::getTickCount();
+		for( int i = 0; i < iterations; i++ )
+		{
+			rleThresholdInv( &gray, &r1, thresh );
+			rleMorph( &r1, &r2, erosion, true );
+			rleMorph( &r2, &r3, dilation, false );
+			labelRleMask( &r3, &blobs, &labels );
+		}
+		int64 t3 = cv::getTickCount();
+
+		double ms = 1000.0 / cv::getTickFrequency() / iterations;
+		std::cout << std::fixed << std::setprecision(2)
+				  << std::setw(9) << densities[d] * 100 << "%" << std::setw(10) << r1.runs.size()
+				  << std::setw(10) << ( t1 - t0 ) * ms << std::setw(10) << ( t2 - t1 ) * ms << std::setw(10) << ( t3 - t2 ) * ms << std::endl;
+	}
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// PIXEL KERNELS ///////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+inline void benchKernels( cv::Size size, int iterations, int thresh, int radius )
+{
+	// Times every available kernel variant over a whole frame, row by row, and
+	// reports the speedup over the scalar reference
+
+	std::vector<const PixelKernels*> list;
+	availableKernels( &list );
+
+	cv::RNG rng( 12345 );
+	cv::Mat gray, bin, color, grayPad;
+	syntheticTable( &gray, size, 0.05, &rng );
+	cv::threshold( gray, bin, thresh, 255, cv::THRESH_BINARY_INV );
+	cv::copyMakeBorder( bin, bin, 0, 0, radius, radius, cv::BORDER_REPLICATE );
+	cv::cvtColor( gray, color, CV_GRAY2BGR );
+	cv::copyMakeBorder( gray, grayPad, 0, 0, 1, 1, cv::BORDER_REFLECT_101 );
+
+	int words = ( size.width + 63 ) / 64;
+	std::vector<uint64_t> a( words ), b( words ), c( words );
+
+	// The mask at 1 bit per pixel, each row between two empty words
+	std::vector<uint64_t> packed( (size_t)size.height * ( words + 2 ), 0 );
+	for( int y = 0; y < size.height; y++ )
+		scalarKernels()->thresholdBits( gray.ptr<uchar>(y), &packed[ (size_t)y * ( words + 2 ) + 1 ], size.width, thresh );
+	std::vector<uchar> out( size.width );
+	std::vector<uint16_t> sums( size.width );
+
+	// One distance row per image row, as many centers as pixels
+	std::vector<float> cx( size.width ), cy( size.width ), dist( size.width );
+	for( int x = 0; x < size.width; x++ )
+	{
+		cx[x] = rng.uniform( 0.f, (float)size.width );
+		cy[x] = rng.uniform( 0.f, (float)size.height );
+	}
+
+	// 64 polygons of 4 to 67 corners, moments once per row
+	std::vector<int> xy, offsets( 1, 0 );
+	for( int p = 0; p < 64; p++ )
+	{
+		for( int j = 0; j < 4 + p; j++ )
+		{
+			xy.push_back( rng.uniform( 0, size.width ) );
+			xy.push_back( rng.uniform( 0, size.height ) );
+		}
+		offsets.push_back( (int)xy.size() / 2 );
+	}
+	std::vector<double> m00( 64 ), m10( 64 ), m01( 64 );
+	std::vector<int> idx( size.width );
+
+	const char *names[] = { "thresholdBits", "andNotWords", "andRow", "orRow", "erodeRowH", "dilateRowH", "distanceRow", "profileRow", "nextSet",
+							"polygonMoments", "selectAbove", "grayRow", "blurThresholdRow", "erodeWordsH", "dilateWordsH" };
+	const int nKernels = 15;
+	std::vector<double> scalar( nKernels );
+
+	std::cout << "Pixel kernels, " << size.width << "x" << size.height << ", " << iterations << " iterations (ms per frame, speedup)" << std::endl;
+	std::cout << std::setw(10) << "variant";
+	for( int n = 0; n < nKernels; n++ ) std::cout << std::setw(20) << names[n];
+	std::cout << std::endl;
+
+	for( size_t v = 0; v < list.size(); v++ )
+	{
+		const PixelKernels *k = list[v];
+		std::cout << std::setw(10) << k->name;
+
+		for( int n = 0; n < nKernels; n++ )
+		{
+			int64 t0 = cv::getTickCount();
+			for( int i = 0; i < iterations; i++ )
+			{
+				for( int y = 0; y < size.height; y++ )
+				{
+					const uchar *g = gray.ptr<uchar>(y);
+					const uchar *p = bin.ptr<uchar>(y);
+					switch( n )
+					{
+					case 0: k->thresholdBits( g, &a[0], size.width, thresh ); break;
+					case 1: k->andNotWords( &a[0], &b[0], &c[0], words ); break;
+					case 2: k->andRow( &out[0], g, size.width ); break;
+					case 3: k->orRow( &out[0], g, size.width ); break;
+					case 4: k->erodeRowH( p, &out[0], size.width, radius ); break;
+					case 5: k->dilateRowH( p, &out[0], size.width, radius ); break;
+					case 6: k->distanceRow( &cx[0], &cy[0], cx[y % size.width], cy[y % size.width], &dist[0], size.width ); break;
+					case 7: if( y == 0 ) std::fill( sums.begin(), sums.end(), 0 );
+							k->profileRow( p + radius, &sums[0], size.width ); break;
+					case 8: for( int x = k->nextSet( p, 0, size.width ); x < size.width; x = k->nextSet( p, x + 1, size.width ) ) out[0] ^= p[x];
+							break;
+					case 9: k->polygonMoments( &xy[0], &offsets[0], 64, &m00[0], &m10[0], &m01[0] ); break;
+					case 10: k->selectAbove( &cx[0], size.width, cx[y % size.width], &idx[0] ); break;
+					case 11: k->grayRow( color.ptr<uchar>(y), &out[0], size.width ); break;
+					case 12: k->blurThresholdRow( grayPad.ptr<uchar>( std::max( y - 1, 0 ) ), grayPad.ptr<uchar>(y),
+												  grayPad.ptr<uchar>( std::min( y + 1, size.height - 1 ) ), &out[0], size.width, thresh ); break;
+					case 13: k->erodeWordsH( &packed[ (size_t)y * ( words + 2 ) ], &c[0], words, radius ); break;
+					case 14: k->dilateWordsH( &packed[ (size_t)y * ( words + 2 ) ], &c[0], words, radius ); break;
+					}
+				}
+			}
+			double ms = ( cv::getTickCount() - t0 ) * 1000.0 / cv::getTickFrequency() / iterations;
+			if( v == 0 ) scalar[n] = ms;
+
+			std::ostringstream cell;
+			cell << std::fixed << std::setprecision(3) << ms << " (" << std::setprecision(1) << scalar[n] / ms << "x)";
+			std::cout << std::setw(20) << cell.str();
+		}
+		std::cout << std::endl;
+	}
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// FRAME PIPELINES /////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+template<class GuiPipeline, class HeadlessPipeline>
+inline void benchFramePipelines( cv::Size size, int iterations, int thresh, int erosion, int dilation )
+{
+	// Times the whole per-pixel chain, from the color frame to the opened mask
+	// and its blobs: OpenCV functions, runtime scanline and the two compile-time
+	// specialized pipelines
+
+	cv::RNG rng( 12345 );
+	cv::Mat gray, frame, mask, hsv, skin, view;
+	std::vector<cv::Mat> planes;
+	std::vector<Blob> blobs;
+	std::vector<std::vector<cv::Point> > contours;
+	std::vector<cv::Vec4i> hierarchy;
+
+	syntheticTable( &gray, size, 0.05, &rng );
+	cv::cvtColor( gray, frame, CV_GRAY2BGR );
+
+	cv::Mat el1 = cv::getStructuringElement( cv::MORPH_RECT, cv::Size( 2*erosion + 1, 2*erosion + 1 ), cv::Point( erosion, erosion ) );
+	cv::Mat el2 = cv::getStructuringElement( cv::MORPH_RECT, cv::Size( 2*dilation + 1, 2*dilation + 1 ), cv::Point( dilation, dilation ) );
+
+	ScanlinePipeline scanline( thresh, erosion, dilation );
+	GuiPipeline gui;
+	HeadlessPipeline headless;
+
+	int64 t0 = cv::getTickCount();
+	for( int i = 0; i < iterations; i++ )
+	{
+		cv::cvtColor( frame, mask, CV_RGB2GRAY );
+		cv::blur( mask, mask, cv::Size(3,3) );
+		cv::threshold( mask, mask, thresh, 255, cv::THRESH_BINARY_INV );
+		cv::cvtColor( frame, hsv, CV_BGR2HSV );
+		cv::split( hsv, planes );
+		cv::threshold( planes[0], planes[0], 18, 255, cv::THRESH_BINARY_INV );
+		cv::threshold( planes[1], planes[1], 50, 255, cv::THRESH_BINARY_INV );
+		cv::threshold( planes[2], planes[2], 80, 255, cv::THRESH_BINARY_INV );
+		cv::bitwise_and( planes[0], planes[1], skin );
+		cv::bitwise_and( skin, planes[2], skin );
+		cv::bitwise_not( skin, skin );
+		cv::subtract( mask, skin, mask );
+		cv::erode( mask, mask, el1 );
+		cv::dilate( mask, mask, el2 );
+		cv::findContours( mask, contours, hierarchy, CV_RETR_TREE, CV_CHAIN_APPROX_SIMPLE, cv::Point(0, 0) );
+	}
+
+	int64 t1 = cv::getTickCount();
+	for( int i = 0; i < iterations; i++ ) scanline.run( &frame, &mask, &view, &blobs );
+
+	int64 t2 = cv::getTickCount();
+	for( int i = 0; i < iterations; i++ ) gui.run( &frame, &mask, &view, &blobs );
+
+	int64 t3 = cv::getTickCount();
+	for( int i = 0; i < iterations; i++ ) headless.run( &frame, &mask, &view, &blobs );
+	int64 t4 = cv::getTickCount();
+
+	double ms = 1000.0 / cv::getTickFrequency() / iterations;
+	std::cout << "Frame pipelines, " << size.width << "x" << size.height << ", " << iterations << " iterations (ms per frame)" << std::endl;
+	std::cout << std::fixed << std::setprecision(2)
+			  << std::setw(18) << "opencv"          << std::setw(10) << ( t1 - t0 ) * ms << std::endl
+			  << std::setw(18) << "scanline"        << std::setw(10) << ( t2 - t1 ) * ms << std::endl
+			  << std::setw(18) << "static gui"      << std::setw(10) << ( t3 - t2 ) * ms << std::endl
+			  << std::setw(18) << "static headless" << std::setw(10) << ( t4 - t3 ) * ms << std::endl;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// TILES ///////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+inline void benchTiles( cv::Size size, int iterations, int thresh, int erosion, int dilation )
+{
+	// Full scanline pass against the tile pipeline when a growing band of the
+	// frame changes between consecutive frames
+
+	cv::RNG rng( 12345 );
+	cv::Mat gray, moved, frames[2], mask, view;
+	std::vector<Blob> blobs;
+
+	syntheticTable( &gray, size, 0.05, &rng );
+	syntheticTable( &moved, size, 0.05, &rng );
+
+	ScanlinePipeline scanline( thresh, erosion, dilation );
+
+	std::cout << "Tiles, " << size.width << "x" << size.height << ", " << iterations << " iterations (ms per frame)" << std::endl;
+	std::cout << std::setw(10) << "changed" << std::setw(10) << "scanline" << std::setw(10) << "tiles" << std::setw(10) << "dirty" << std::endl;
+
+	const double changed[] = { 0.0, 0.05, 0.25, 1.0 };
+	for( int c = 0; c < 4; c++ )
+	{
+		// The second frame has the top `changed` rows of another table
+		int band = cvRound( size.height * changed[c] );
+		cv::cvtColor( gray, frames[0], CV_GRAY2BGR );
+		frames[0].copyTo( frames[1] );
+		cv::Mat top = frames[1].rowRange( 0, band );
+		cv::cvtColor( moved.rowRange( 0, band ), top, CV_GRAY2BGR );
+
+		TilePipeline tiles( thresh, erosion, dilation );
+		tiles.run( &frames[0], &mask, NULL, &blobs );
+
+		int64 t0 = cv::getTickCount();
+		for( int i = 0; i < iterations; i++ ) scanline.run( &frames[ ( i + 1 ) & 1 ], &mask, NULL, &blobs );
+
+		int64 t1 = cv::getTickCount();
+		long dirty = 0, total = 0;
+		for( int i = 0; i < iterations; i++ )
+		{
+			tiles.run( &frames[ ( i + 1 ) & 1 ], &mask, NULL, &blobs );
+			dirty += tiles.dirtyTiles;
+			total += tiles.totalTiles;
+		}
+		int64 t2 = cv::getTickCount();
+
+		double ms = 1000.0 / cv::getTickFrequency() / iterations;
+		std::cout << std::fixed << std::setprecision(2)
+				  << std::setw(9) << changed[c] * 100 << "%"
+				  << std::setw(10) << ( t1 - t0 ) * ms
+				  << std::setw(10) << ( t2 - t1 ) * ms
+				  << std::setw(9) << 100.0 * dirty / std::max( total, 1L ) << "%" << std::endl;
+	}
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// PROFILES ////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+inline void benchProfiles( cv::Size size, int iterations, int thresh, int erosion, int dilation, double minArea )
+{
+	// Scanline pass and blob labeling against the projection profiles, on a
+	// table with two dark objects; also reports how far apart the centers are
+
+	cv::RNG rng( 12345 );
+	cv::Mat gray, frame, mask;
+	syntheticTable( &gray, size, 0, &rng );
+	cv::rectangle( gray, cv::Point( size.width / 8, size.height / 4 ), cv::Point( size.width / 8 + 80, size.height / 4 + 60 ), cv::Scalar(20), -1 );
+	cv::rectangle( gray, cv::Point( size.width * 5 / 8, size.height * 5 / 8 ), cv::Point( size.width * 5 / 8 + 50, size.height * 5 / 8 + 90 ), cv::Scalar(20), -1 );
+	cv::cvtColor( gray, frame, CV_GRAY2BGR );
+
+	ScanlinePipeline scanline( thresh, erosion, dilation );
+	ProfileDetector profiles( thresh, erosion, minArea );
+	std::vector<Blob> full, fast;
+
+	int64 t0 = cv::getTickCount();
+	for( int i = 0; i < iterations; i++ ) scanline.run( &frame, &mask, NULL, &full );
+	int64 t1 = cv::getTickCount();
+	bool found = true;
+	for( int i = 0; i < iterations; i++ ) found = profiles.run( &frame, &mask, &fast ) && found;
+	int64 t2 = cv::getTickCount();
+
+	// Largest distance from a profile center to the nearest labeled center
+	double worst = 0;
+	for( size_t i = 0; i < fast.size(); i++ )
+	{
+		double best = 1e9;
+		for( size_t j = 0; j < full.size(); j++ )
+			if( full[j].m00 > minArea ) best = std::min( best, (double)cv::norm( fast[i].center() - full[j].center() ) );
+		worst = std::max( worst, best );
+	}
+
+	double ms = 1000.0 / cv::getTickFrequency() / iterations;
+	std::cout << "Profiles, " << size.width << "x" << size.height << ", " << iterations << " iterations (ms per frame)" << std::endl;
+	std::cout << std::setw(10) << "scanline" << std::setw(10) << "profiles" << std::setw(14) << "center error" << std::endl;
+	std::cout << std::fixed << std::setprecision(2)
+			  << std::setw(10) << ( t1 - t0 ) * ms
+			  << std::setw(10) << ( t2 - t1 ) * ms;
+	if( found ) std::cout << std::setw(12) << worst << "px" << std::endl;
+	else        std::cout << std::setw(14) << "ambiguous" << std::endl;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// SKIN FILTER /////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+inline void benchSkin( cv::Size size, int iterations, int thresh )
+{
+	// Skin filter and subtraction over the whole frame in HSV, as the dense
+	// path did, against the conversion of the dark pixels only
+
+	const double densities[] = { 0.01, 0.05, 0.25, 0.50 };
+	const int nDensities = sizeof(densities) / sizeof(densities[0]);
+
+	cv::RNG rng( 12345 );
+	cv::Mat gray, frame, dark, mask, imgHSV, imgSkin;
+	std::vector<cv::Mat> planes;
+	HsvTables hsv;
+
+	std::cout << "Skin filter, " << size.width << "x" << size.height << ", " << iterations << " iterations (ms per frame)" << std::endl;
+	std::cout << std::setw(10) << "density" << std::setw(10) << "full" << std::setw(10) << "sparse" << std::endl;
+
+	for( int d = 0; d < nDensities; d++ )
+	{
+		syntheticTable( &gray, size, densities[d], &rng );
+		cv::cvtColor( gray, frame, CV_GRAY2BGR );
+		cv::threshold( gray, dark, thresh, 255, cv::THRESH_BINARY_INV );
+
+		int64 t0 = cv::getTickCount();
+		for( int i = 0; i < iterations; i++ )
+		{
+			cv::cvtColor( frame, imgHSV, CV_BGR2HSV );
+			cv::split( imgHSV, planes );
+			cv::threshold( planes[0], planes[0], 18, 255, cv::THRESH_BINARY_INV );
+			cv::threshold( planes[1], planes[1], 50, 255, cv::THRESH_BINARY_INV );
+			cv::threshold( planes[2], planes[2], 80, 255, cv::THRESH_BINARY_INV );
+			cv::bitwise_and( planes[0], planes[1], imgSkin );
+			cv::bitwise_and( imgSkin, planes[2], imgSkin );
+			cv::bitwise_not( imgSkin, imgSkin );
+			cv::subtract( dark, imgSkin, mask );
+		}
+
+		int64 t1 = cv::getTickCount();
+		for( int i = 0; i < iterations; i++ )
+		{
+			dark.copyTo( mask );
+			sparseSkinFilter( &frame, &mask, &hsv, 18, 50, 80 );
+		}
+		int64 t2 = cv::getTickCount();
+
+		double ms = 1000.0 / cv::getTickFrequency() / iterations;
+		std::cout << std::fixed << std::setprecision(2)
+				  << std::setw(9) << densities[d] * 100 << "%"
+				  << std::setw(10) << ( t1 - t0 ) * ms
+				  << std::setw(10) << ( t2 - t1 ) * ms << std::endl;
+	}
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// TOP K ///////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+inline void benchTopK( int contours, int iterations )
+{
+	// Partial selection of the K biggest of `contours` areas against a full
+	// sort, then the K x K distance matrix of their centers
+
+	cv::RNG rng( 12345 );
+	std::vector<double> areas( contours );
+	std::vector<cv::Point2f> all( contours );
+	for( int i = 0; i < contours; i++ )
+	{
+		areas[i] = ( i % 3 ) ? rng.uniform( 1.0, 5000.0 ) : 0;       // A third below the area threshold
+		all[i]   = cv::Point2f( rng.uniform( 0.f, 1920.f ), rng.uniform( 0.f, 1080.f ) );
+	}
+
+	std::cout << "Top K of " << contours << " contours, " << iterations << " iterations (ms)" << std::endl;
+	std::cout << std::setw(10) << "k" << std::setw(10) << "sort" << std::setw(10) << "topK" << std::setw(10) << "matrix" << std::endl;
+
+	const int ks[] = { 2, 16, 128, 512 };
+	std::vector<int> idx, order( contours );
+	std::vector<cv::Point2f> centers;
+	PairwiseDistances pairs;
+
+	for( int c = 0; c < 4; c++ )
+	{
+		int k = ks[c];
+
+		int64 t0 = cv::getTickCount();
+		for( int i = 0; i < iterations; i++ )
+		{
+			for( int j = 0; j < contours; j++ ) order[j] = j;
+			std::sort( order.begin(), order.end(), [&]( int a, int b ) { return areas[a] > areas[b]; } );
+		}
+
+		int64 t1 = cv::getTickCount();
+		for( int i = 0; i < iterations; i++ ) selectTopK( &areas, k, &idx );
+
+		int64 t2 = cv::getTickCount();
+		for( int i = 0; i < iterations; i++ )
+		{
+			centers.clear();
+			for( size_t j = 0; j < idx.size(); j++ ) centers.push_back( all[ idx[j] ] );
+			pairs.compute( &centers );
+		}
+		int64 t3 = cv::getTickCount();
+
+		double ms = 1000.0 / cv::getTickFrequency() / iterations;
+		std::cout << std::fixed << std::setprecision(3)
+				  << std::setw(10) << k
+				  << std::setw(10) << ( t1 - t0 ) * ms
+				  << std::setw(10) << ( t2 - t1 ) * ms
+				  << std::setw(10) << ( t3 - t2 ) * ms << std::endl;
+	}
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// TRACKER /////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+inline void benchTracker( int frames )
+{
+	// Objects bouncing around a 1080p frame at up to 3 pixels per frame, given
+	// to the tracker in a new random order every frame: time per update and
+	// how often an object changed id
+
+	std::cout << "Tracker, " << frames << " frames (ms per frame)" << std::endl;
+	std::cout << std::setw(10) << "objects" << std::setw(10) << "update" << std::setw(10) << "switches" << std::endl;
+
+	const int counts[] = { 2, 32, 128, 512 };
+	for( int c = 0; c < 4; c++ )
+	{
+		int n = counts[c];
+		cv::RNG rng( 12345 );
+		std::vector<cv::Point2f> pos( n ), vel( n ), shuffled( n );
+		std::vector<int> order( n ), ids, last( n, -1 );
+		for( int i = 0; i < n; i++ )
+		{
+			pos[i] = cv::Point2f( rng.uniform( 0.f, 1920.f ), rng.uniform( 0.f, 1080.f ) );
+			vel[i] = cv::Point2f( rng.uniform( -3.f, 3.f ), rng.uniform( -3.f, 3.f ) );
+			order[i] = i;
+		}
+
+		ObjectTracker tracker( 20, 5 );
+		long switches = 0;
+		int64 spent = 0;
+
+		for( int f = 0; f < frames; f++ )
+		{
+			for( int i = n - 1; i > 0; i-- ) std::swap( order[i], order[ rng.uniform( 0, i + 1 ) ] );
+			for( int i = 0; i < n; i++ ) shuffled[i] = pos[ order[i] ];
+
+			int64 t0 = cv::getTickCount();
+			tracker.update( &shuffled, &ids );
+			spent += cv::getTickCount() - t0;
+
+			for( int i = 0; i < n; i++ )
+			{
+				int &prev = last[ order[i] ];
+				if( prev >= 0 && prev != ids[i] ) switches++;
+				prev = ids[i];
+			}
+
+			for( int i = 0; i < n; i++ )
+			{
+				pos[i] += vel[i];
+				if( pos[i].x < 0 || pos[i].x > 1920 ) vel[i].x = -vel[i].x;
+				if( pos[i].y < 0 || pos[i].y > 1080 ) vel[i].y = -vel[i].y;
+			}
+		}
+
+		std::cout << std::fixed << std::setprecision(3)
+				  << std::setw(10) << n
+				  << std::setw(10) << spent * 1000.0 / cv::getTickFrequency() / frames
+				  << std::setw(10) << switches << std::endl;
+	}
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// ANALYZER ////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+inline void benchAnalyzer( cv::Size size, int frames, int workers )
+{
+	// Throughput of libaoss_vision on small frames through futures and
+	// callbacks, and the cost of a submit on its own (1x1 frames, which the
+	// workers reject at once)
+
+	cv::RNG rng( 12345 );
+	cv::Mat gray, frame, tiny( 1, 1, CV_8UC1, cv::Scalar(0) );
+	syntheticTable( &gray, size, 0.05, &rng );
+	cv::cvtColor( gray, frame, CV_GRAY2BGR );
+
+	AnalyzerConfig config;
+	config.workers  = workers;
+	config.capacity = 4 * workers;
+	config.minArea  = 100;
+
+	double ms[3];
+	for( int mode = 0; mode < 3; mode++ )
+	{
+		Analyzer analyzer( config );
+		std::vector<std::future<AnalyzerResult> > futures;
+		std::atomic<int> done( 0 );
+		futures.reserve( frames );
+
+		int64 t0 = cv::getTickCount();
+		for( int i = 0; i < frames; i++ )
+		{
+			if( mode == 0 ) futures.push_back( analyzer.submit( frame, i ) );
+			else analyzer.submit( mode == 1 ? frame : tiny, i, [&done]( const AnalyzerResult & ) { done++; } );
+		}
+		for( size_t i = 0; i < futures.size(); i++ ) futures[i].get();
+		while( done < ( mode ? frames : 0 ) ) std::this_thread::yield();
+
+		ms[mode] = ( cv::getTickCount() - t0 ) * 1000.0 / cv::getTickFrequency();
+	}
+
+	std::cout << "Analyzer, " << size.width << "x" << size.height << ", " << frames << " frames, " << workers << " workers" << std::endl;
+	std::cout << std::fixed << std::setprecision(0)
+			  << std::setw(18) << "futures"   << std::setw(10) << frames * 1000.0 / ms[0] << " frames/s" << std::endl
+			  << std::setw(18) << "callbacks" << std::setw(10) << frames * 1000.0 / ms[1] << " frames/s" << std::endl
+			  << std::setprecision(2)
+			  << std::setw(18) << "submit only" << std::setw(10) << ms[2] * 1000.0 / frames << " us/frame" << std::endl;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// BAR CHART ///////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+inline void benchBarChart( int height, int iterations )
+{
+	// A chart rebuilt every frame, as drawBarChart() used to, against the
+	// cached one, with bars that move by a few pixels per frame
+
+	cv::Mat chart;
+	int values[6];
+
+	int64 t0 = cv::getTickCount();
+	for( int i = 0; i < iterations; i++ )
+	{
+		BarChart full( 400 );
+		for( int b = 0; b < 6; b++ ) full.addBar( 5 + 50*b, 40, cv::Scalar( 40*b, 255, 255 - 40*b ), "xy" );
+		for( int b = 0; b < 6; b++ ) values[b] = ( 100 + 37*b + 3*i ) % height;
+		full.draw( &chart, height, values );
+	}
+
+	int64 t1 = cv::getTickCount();
+	BarChart cached( 400 );
+	for( int b = 0; b < 6; b++ ) cached.addBar( 5 + 50*b, 40, cv::Scalar( 40*b, 255, 255 - 40*b ), "xy" );
+	for( int i = 0; i < iterations; i++ )
+	{
+		for( int b = 0; b < 6; b++ ) values[b] = ( 100 + 37*b + 3*i ) % height;
+		cached.draw( &chart, height, values );
+	}
+	int64 t2 = cv::getTickCount();
+
+	double us = 1e6 / cv::getTickFrequency() / iterations;
+	std::cout << "Bar chart, 400x" << height + 50 << ", " << iterations << " iterations (us per frame)" << std::endl;
+	std::cout << std::fixed << std::setprecision(1)
+			  << std::setw(18) << "full redraw" << std::setw(10) << ( t1 - t0 ) * us << std::endl
+			  << std::setw(18) << "cached"      << std::setw(10) << ( t2 - t1 ) * us << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// FRAME POOL //////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+inline double handOverFrames( cv::Size size, int frames, FramePool *pool )
+{
+	// One thread fills a new frame each time and hands it to another, which
+	// reads it and lets it go, at most 2 frames in flight as with the display.
+	// Returns ms per frame
+
+	std::mutex lock;
+	std::condition_variable changed;
+	std::deque<cv::Mat> queue;
+	bool done = false;
+	volatile int sink = 0;
+
+	std::thread reader( [&]()
+	{
+		while( true )
+		{
+			cv::Mat f;
+			{
+				std::unique_lock<std::mutex> guard( lock );
+				while( queue.empty() && !done ) changed.wait( guard );
+				if( queue.empty() ) return;
+				f = queue.front();
+				queue.pop_front();
+			}
+			changed.notify_all();
+			sink += f.data[ f.total() * f.elemSize() / 2 ];
+		}
+	} );
+
+	int64 t0 = cv::getTickCount();
+	for( int i = 0; i < frames; i++ )
+	{
+		cv::Mat f;
+		if( pool ) f = pool->get( size, CV_8UC3 );
+		else f.create( size, CV_8UC3 );
+		f.setTo( cv::Scalar( i, i, i ) );
+
+		std::unique_lock<std::mutex> guard( lock );
+		while( queue.size() >= 2 ) changed.wait( guard );
+		queue.push_back( f );
+		changed.notify_all();
+	}
+	{
+		std::lock_guard<std::mutex> guard( lock );
+		done = true;
+	}
+	changed.notify_all();
+	reader.join();
+
+	return ( cv::getTickCount() - t0 ) * 1000.0 / cv::getTickFrequency() / frames;
+}
+
+inline void benchFramePool( cv::Size size, int frames )
+{
+	// Frames allocated by OpenCV and freed on the other thread, against
+	// frames recycled by the pool, on ordinary and on huge pages
+
+	size_t bytes = (size_t)size.area() * 3;
+	FramePool pool( bytes ), huge( bytes, true );
+
+	double plain  = handOverFrames( size, frames, NULL );
+	double pooled = handOverFrames( size, frames, &pool );
+	double onHuge = handOverFrames( size, frames, &huge );
+
+	std::cout << "Frame hand-over, " << size.width << "x" << size.height << ", " << frames << " frames (ms per frame)" << std::endl;
+	std::cout << std::fixed << std::setprecision(3)
+			  << std::setw(18) << "cv::Mat"          << std::setw(10) << plain  << std::endl
+			  << std::setw(18) << "frame pool"       << std::setw(10) << pooled << std::endl
+			  << std::setw(18) << "pool, huge pages" << std::setw(10) << onHuge << std::endl;
+	pool.report( std::cout );
+	huge.report( std::cout );
+}
+
+#endif
@@ -0,0 +1,130 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// AOSS Vision Module - Marco Lancini (www.marcolancini.it)
+//
+//
+// Copyright (C) 2012 Marco Lancini
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef AOSS_BLOB_TABLE_HPP
+#define AOSS_BLOB_TABLE_HPP
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "AOSS_Blobs.hpp"
+#include "AOSS_Kernels.hpp"
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// BLOB TABLE //////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// The objects of one frame, one column per field, so that a pass over one
+// field (the areas, to filter or select) reads nothing else. The columns keep
+// their memory from frame to frame.
+class BlobTable
+{
+public:
+	std::vector<float> area;
+	std::vector<float> cx, cy;                  // Mass center
+	std::vector<int> minx, miny, maxx, maxy;    // Bounding box, inclusive
+	std::vector<int> source;                    // Index in the engine blobs and outlines, -1 if none
+
+	int size() const { return (int)area.size(); }
+
+	void clear() { resize( 0 ); }
+
+	void push( float a, cv::Point2f c, cv::Rect box, int src )
+	{
+		area.push_back( a );
+		cx.push_back( c.x );
+		cy.push_back( c.y );
+		minx.push_back( box.x );
+		miny.push_back( box.y );
+		maxx.push_back( box.x + box.width - 1 );
+		maxy.push_back( box.y + box.height - 1 );
+		source.push_back( src );
+	}
+
+	// Keeps the blobs bigger than minArea. The areas are gathered and scanned
+	// first, without a branch per blob, then the other columns are filled for
+	// the kept blobs only
+	void assign( const std::vector<Blob> *blobs, float minArea )
+	{
+		int n = (int)blobs->size();
+		all.resize( n );
+		kept.resize( n );
+		for( int i = 0; i < n; i++ ) all[i] = (float)(*blobs)[i].m00;
+		int k = n ? kernels()->selectAbove( &all[0], n, minArea, &kept[0] ) : 0;
+
+		resize( k );
+		for( int j = 0; j < k; j++ )
+		{
+			const Blob &b = (*blobs)[ kept[j] ];
+			area[j]   = all[ kept[j] ];
+			cx[j]     = (float)( b.m10 / b.m00 );
+			cy[j]     = (float)( b.m01 / b.m00 );
+			minx[j]   = b.minx;
+			miny[j]   = b.miny;
+			maxx[j]   = b.maxx;
+			maxy[j]   = b.maxy;
+			source[j] = kept[j];
+		}
+	}
+
+	// Moves every blob, as from table to frame coordinates
+	void shift( cv::Point d )
+	{
+		for( int i = 0; i < size(); i++ )
+		{
+			cx[i] += d.x;
+			cy[i] += d.y;
+			minx[i] += d.x;
+			maxx[i] += d.x;
+			miny[i] += d.y;
+			maxy[i] += d.y;
+		}
+	}
+
+	cv::Point2f center( int i ) const { return cv::Point2f( cx[i], cy[i] ); }
+	cv::Rect box( int i ) const { return cv::Rect( minx[i], miny[i], maxx[i] - minx[i] + 1, maxy[i] - miny[i] + 1 ); }
+
+private:
+	std::vector<float> all;         // Areas of every blob, before the filter
+	std::vector<int> kept;
+
+	void resize( int n )
+	{
+		area.resize( n );
+		cx.resize( n );
+		cy.resize( n );
+		minx.resize( n );
+		miny.resize( n );
+		maxx.resize( n );
+		maxy.resize( n );
+		source.resize( n );
+	}
+};
+
+#endif
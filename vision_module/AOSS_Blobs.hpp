@@ -0,0 +1,241 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// AOSS Vision Module - Marco Lancini (www.marcolancini.it)
+//
+//
+// Copyright (C) 2012 Marco Lancini
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef AOSS_BLOBS_HPP
+#define AOSS_BLOBS_HPP
+
+#include <vector>
+#include <climits>
+#include <algorithm>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// TYPES ///////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Horizontal run of foreground pixels: row y, columns [x0, x1)
+struct Run
+{
+	int y;
+	int x0;
+	int x1;
+};
+
+// Connected component of a binary mask, accumulated run by run
+struct Blob
+{
+	double m00;     // Area (pixel count)
+	double m10;     // Sum of x
+	double m01;     // Sum of y
+	int minx, miny, maxx, maxy;
+
+	Blob() : m00(0), m10(0), m01(0), minx(INT_MAX), miny(INT_MAX), maxx(-1), maxy(-1) {}
+
+	void add( const Run &r )
+	{
+		double len = r.x1 - r.x0;
+		m00 += len;
+		m10 += len * ( r.x0 + r.x1 - 1 ) * 0.5;
+		m01 += len * r.y;
+		if( r.x0 < minx )     minx = r.x0;
+		if( r.x1 - 1 > maxx ) maxx = r.x1 - 1;
+		if( r.y < miny )      miny = r.y;
+		if( r.y > maxy )      maxy = r.y;
+	}
+
+	void merge( const Blob &b )
+	{
+		m00 += b.m00;
+		m10 += b.m10;
+		m01 += b.m01;
+		minx = std::min( minx, b.minx );
+		miny = std::min( miny, b.miny );
+		maxx = std::max( maxx, b.maxx );
+		maxy = std::max( maxy, b.maxy );
+	}
+
+	cv::Point2f center() const { return cv::Point2f( m10/m00, m01/m00 ); }
+	cv::Rect    box()    const { return cv::Rect( minx, miny, maxx - minx + 1, maxy - miny + 1 ); }
+	cv::Moments moments() const { return cv::Moments( m00, m10, m01, 0, 0, 0, 0, 0, 0, 0 ); }
+};
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// RUN LABELING ////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+inline int findRoot( std::vector<int> *parent, int i )
+{
+	while( (*parent)[i] != i )
+	{
+		(*parent)[i] = (*parent)[ (*parent)[i] ];   // Path halving
+		i = (*parent)[i];
+	}
+	return i;
+}
+
+inline void labelRuns( const std::vector<Run> *runs, std::vector<Blob> *blobs, std::vector<int> *labels )
+{
+	// Groups 8-connected runs into blobs. Runs must be sorted by row, then by x.
+	// On return labels[i] is the index in blobs of the component of runs[i]
+
+	int n = runs->size();
+	std::vector<int> parent( n );
+	for( int i = 0; i < n; i++ ) parent[i] = i;
+
+	// Merge runs of consecutive rows whose extents touch (diagonals included)
+	int prevBegin = 0, prevEnd = 0;
+	int i = 0;
+	while( i < n )
+	{
+		int y = runs->at(i).y;
+		int curBegin = i;
+		while( i < n && runs->at(i).y == y ) i++;
+
+		if( prevEnd > prevBegin && runs->at(prevBegin).y == y - 1 )
+		{
+			int p = prevBegin;
+			for( int c = curBegin; c < i; c++ )
+			{
+				const Run &cur = runs->at(c);
+				while( p < prevEnd && runs->at(p).x1 < cur.x0 ) p++;
+
+				for( int q = p; q < prevEnd && runs->at(q).x0 <= cur.x1; q++ )
+				{
+					int a = findRoot( &parent, q );
+					int b = findRoot( &parent, c );
+					if( a != b ) parent[ std::max(a, b) ] = std::min(a, b);
+				}
+			}
+		}
+
+		prevBegin = curBegin;
+		prevEnd   = i;
+	}
+
+	// Accumulate statistics per root
+	blobs->clear();
+	labels->resize( n );
+	std::vector<int> blobOf( n, -1 );
+	for( int k = 0; k < n; k++ )
+	{
+		int root = findRoot( &parent, k );
+		if( blobOf[root] < 0 )
+		{
+			blobOf[root] = blobs->size();
+			blobs->push_back( Blob() );
+		}
+		(*labels)[k] = blobOf[root];
+		blobs->at( blobOf[root] ).add( runs->at(k) );
+	}
+}
+
+// Labels a mask fed one row at a time, top to bottom, keeping only the runs
+// of the previous row: statistics are merged when two labels meet
+struct RowLabeler
+{
+	std::vector<int>  parent;
+	std::vector<Blob> stats;
+	std::vector<Run>  prevRuns, curRuns;
+	std::vector<int>  prevLab, curLab;
+
+	void reset()
+	{
+		parent.clear();
+		stats.clear();
+		prevRuns.clear();
+		prevLab.clear();
+	}
+
+	int unite( int a, int b )
+	{
+		a = findRoot( &parent, a );
+		b = findRoot( &parent, b );
+		if( a == b ) return a;
+		if( a > b ) std::swap( a, b );
+		parent[b] = a;
+		stats[a].merge( stats[b] );
+		return a;
+	}
+
+	void pushRow( int y, const uchar *row, int cols )
+	{
+		// Runs of non-zero pixels of row y, merged with the touching runs of row y-1
+		curRuns.clear();
+		curLab.clear();
+
+		int x = 0;
+		while( x < cols )
+		{
+			while( x < cols && !row[x] ) x++;
+			if( x == cols ) break;
+			Run r = { y, x, 0 };
+			while( x < cols && row[x] ) x++;
+			r.x1 = x;
+			curRuns.push_back( r );
+		}
+
+		bool adjacent = !prevRuns.empty() && prevRuns[0].y == y - 1;
+		size_t p = 0;
+		for( size_t c = 0; c < curRuns.size(); c++ )
+		{
+			const Run &cur = curRuns[c];
+			int label = -1;
+
+			if( adjacent )
+			{
+				while( p < prevRuns.size() && prevRuns[p].x1 < cur.x0 ) p++;
+				for( size_t q = p; q < prevRuns.size() && prevRuns[q].x0 <= cur.x1; q++ )
+					label = ( label < 0 ) ? findRoot( &parent, prevLab[q] ) : unite( label, prevLab[q] );
+			}
+
+			if( label < 0 )
+			{
+				label = parent.size();
+				parent.push_back( label );
+				stats.push_back( Blob() );
+			}
+			stats[label].add( cur );
+			curLab.push_back( label );
+		}
+
+		prevRuns.swap( curRuns );
+		prevLab.swap( curLab );
+	}
+
+	void finish( std::vector<Blob> *blobs )
+	{
+		blobs->clear();
+		for( size_t i = 0; i < parent.size(); i++ )
+			if( parent[i] == (int)i ) blobs->push_back( stats[i] );
+	}
+};
+
+#endif
@@ -0,0 +1,203 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// AOSS Vision Module - Marco Lancini (www.marcolancini.it)
+//
+//
+// Copyright (C) 2012 Marco Lancini
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef AOSS_CAMSHIFT_HPP
+#define AOSS_CAMSHIFT_HPP
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/video/tracking.hpp>
+
+#include "AOSS_Follower.hpp"
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// CAMSHIFT TRACKER ////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Follows the detected objects with CamShift between two full detections.
+// seed() learns the gray levels of the dark pixels in the object boxes as a
+// histogram and opens one window per object; track() back-projects the
+// histogram on the new frame, a darkness map where the table is 0, and lets
+// CamShift move and resize each window. A window that collapses makes track()
+// fail and the caller runs the detector again, as it does every `interval`
+// frames anyway. Before each new seed the windows are moved once more on the
+// same frame, and their distance from the detected centers is the drift; a
+// window that collapses on that last move is counted as lost at detection.
+class CamShiftTracker : public Follower
+{
+public:
+	int interval;                   // Frames between two full detections
+	int thresh;                     // Darkest gray of the table, as in the detector
+	int minSide;                    // Smallest window side before it counts as lost
+
+	// Statistics
+	int tracked, detections, failures;
+	double driftSum, driftMax;      // Pixels, at each detection after tracking
+	int driftSamples;
+	int lostAtDetection;            // Detections where a window collapsed instead of giving a drift
+
+	CamShiftTracker( int interval_, int thresh_ )
+		: interval(interval_), thresh(thresh_), minSide(3),
+		  tracked(0), detections(0), failures(0), driftSum(0), driftMax(0), driftSamples(0), lostAtDetection(0), since(0) {}
+
+	bool due() const { return windows.empty() || since >= interval; }
+
+	void report( std::ostream &out ) const
+	{
+		out << "CamShift: " << tracked << " frames tracked, " << detections << " detections, "
+			<< failures << " lost, drift " << ( driftSamples ? driftSum / driftSamples : 0 )
+			<< " px mean, " << driftMax << " px max over " << driftSamples << " windows, lost at "
+			<< lostAtDetection << " detections";
+	}
+
+	void seed( const cv::Mat *frame, const std::vector<cv::Rect> *boxes,
+			   const std::vector<cv::Point2f> *centers, const std::vector<double> *areas )
+	{
+		// Objects just found by the detector, in frame coordinates
+
+		cv::cvtColor( *frame, gray, CV_BGR2GRAY );
+		cv::Rect all( 0, 0, frame->cols, frame->rows );
+
+		// Drift of the windows that were following these objects
+		if( !windows.empty() && !backProject() ) lostAtDetection++;
+		else if( !windows.empty() )
+		{
+			for( size_t i = 0; i < centers->size(); i++ )
+			{
+				double best = -1;
+				for( size_t w = 0; w < windows.size(); w++ )
+				{
+					cv::Point2f d = windows[w].center - (*centers)[i];
+					double dist = std::sqrt( d.x * d.x + d.y * d.y );
+					if( best < 0 || dist < best ) best = dist;
+				}
+				driftSum += best;
+				driftMax  = std::max( driftMax, best );
+				driftSamples++;
+			}
+		}
+
+		// Gray levels of the dark pixels of the objects
+		darkMask.create( gray.size(), CV_8UC1 );
+		darkMask.setTo( cv::Scalar(0) );
+		for( size_t i = 0; i < boxes->size(); i++ )
+		{
+			cv::Rect r = (*boxes)[i] & all;
+			cv::Mat dst = darkMask( r );
+			cv::threshold( gray( r ), dst, thresh, 255, cv::THRESH_BINARY_INV );
+		}
+
+		int bins = 32;
+		float range[] = { 0, 256 };
+		const float *ranges[] = { range };
+		int channel = 0;
+		cv::calcHist( &gray, 1, &channel, darkMask, hist, 1, &bins, ranges );
+		cv::normalize( hist, hist, 0, 255, cv::NORM_MINMAX );
+
+		windows.clear();
+		for( size_t i = 0; i < boxes->size(); i++ )
+		{
+			Window w;
+			w.rect   = (*boxes)[i] & all;
+			w.center = (*centers)[i];
+			w.area   = (*areas)[i];
+			if( w.rect.area() > 0 ) windows.push_back( w );
+		}
+		if( windows.size() != boxes->size() ) windows.clear();
+
+		detections++;
+		since = 0;
+	}
+
+	bool track( const cv::Mat *frame, std::vector<cv::Point2f> *centers, std::vector<cv::Rect> *boxes, std::vector<double> *areas )
+	{
+		// Returns false, and forgets the windows, when the detector must run
+
+		cv::cvtColor( *frame, gray, CV_BGR2GRAY );
+		if( !backProject() )
+		{
+			failures++;
+			windows.clear();
+			return false;
+		}
+
+		centers->clear();
+		boxes->clear();
+		areas->clear();
+		for( size_t i = 0; i < windows.size(); i++ )
+		{
+			centers->push_back( windows[i].center );
+			boxes->push_back( windows[i].rect );
+			areas->push_back( windows[i].area );
+		}
+
+		tracked++;
+		since++;
+		return true;
+	}
+
+private:
+	struct Window
+	{
+		cv::Rect rect;
+		cv::Point2f center;
+		double area;                    // At the last detection
+	};
+
+	std::vector<Window> windows;
+	int since;                      // Frames tracked since the last detection
+	cv::Mat gray, darkMask, hist, prob;
+
+	bool backProject()
+	{
+		// Moves every window on the darkness map of `gray`; false if one collapsed
+
+		int channel = 0;
+		float range[] = { 0, 256 };
+		const float *ranges[] = { range };
+		cv::calcBackProject( &gray, 1, &channel, hist, prob, ranges );
+
+		cv::TermCriteria stop( cv::TermCriteria::EPS | cv::TermCriteria::COUNT, 10, 1 );
+		for( size_t i = 0; i < windows.size(); i++ )
+		{
+			Window &w = windows[i];
+			if( w.rect.width < minSide || w.rect.height < minSide ) return false;
+
+			cv::RotatedRect r = cv::CamShift( prob, w.rect, stop );
+			if( r.size.width < minSide || r.size.height < minSide ) return false;
+			w.center = r.center;
+		}
+		return true;
+	}
+};
+
+#endif
@@ -0,0 +1,447 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// AOSS Vision Module - Marco Lancini (www.marcolancini.it)
+//
+//
+// Copyright (C) 2012 Marco Lancini
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef AOSS_DETECTORS_HPP
+#define AOSS_DETECTORS_HPP
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/features2d/features2d.hpp>
+
+#include "AOSS_Blobs.hpp"
+#include "AOSS_PackedMask.hpp"
+#include "AOSS_RleMask.hpp"
+#include "AOSS_Scanline.hpp"
+#include "AOSS_Tiles.hpp"
+#include "AOSS_Profiles.hpp"
+#include "AOSS_Objects.hpp"
+#include "AOSS_Outlines.hpp"
+#include "AOSS_PerfCounters.hpp"
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// DETECTOR ENGINE /////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// A way of finding the dark objects of a frame: a frame in, blobs (area, sum
+// of x and y, bounding box) out. analyzeFrame() and the comparison harness
+// only see this interface; engines are created by name from the registry.
+class DetectorEngine
+{
+public:
+	DetectorEngine() : profile(NULL) {}
+	virtual ~DetectorEngine() {}
+
+	virtual const char* name() const = 0;
+
+	// frame is 8-bit BGR. mask is the working image of the engine, the final
+	// mask for most of them; skinView, if not NULL, receives the skin filter
+	// view. Blobs of any area are returned, the caller applies its threshold
+	virtual void detect( cv::Mat *frame, cv::Mat *mask, cv::Mat *skinView, std::vector<Blob> *blobs ) = 0;
+
+	// Outlines of the last blobs, same order, for the engines that trace them
+	virtual const OutlineArena* outlines() const { return NULL; }
+
+	// End of run statistics, if the engine keeps any
+	virtual void report( std::ostream & ) const {}
+
+	// Hardware counters per stage, NULL for none. The caller begins the
+	// profile before detect(); engines with separate stages end each of them
+	// there, on the calling thread. Fused or threaded stages are not split
+	void profileStages( StageProfile *p ) { profile = p; }
+
+protected:
+	StageProfile *profile;
+
+	void stageDone( const char *stage, const cv::Mat *frame )
+	{
+		if( profile ) profile->end( stage, (double)frame->total() );
+	}
+};
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// REGISTRY ////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+typedef DetectorEngine* (*DetectorFactory)();
+
+struct DetectorEntry
+{
+	std::string name;
+	std::string description;
+	DetectorFactory create;
+};
+
+class DetectorRegistry
+{
+public:
+	void add( const std::string &name, const std::string &description, DetectorFactory create )
+	{
+		DetectorEntry e = { name, description, create };
+		list.push_back( e );
+	}
+
+	// NULL for an unknown name; the caller owns the engine
+	DetectorEngine* create( const std::string &name ) const
+	{
+		for( size_t i = 0; i < list.size(); i++ )
+			if( list[i].name == name ) return list[i].create();
+		return NULL;
+	}
+
+	const std::vector<DetectorEntry>& entries() const { return list; }
+
+	std::string names( const char *separator ) const
+	{
+		std::string s;
+		for( size_t i = 0; i < list.size(); i++ ) s += ( i ? separator : "" ) + list[i].name;
+		return s;
+	}
+
+private:
+	std::vector<DetectorEntry> list;
+};
+
+inline DetectorRegistry& detectorRegistry()
+{
+	static DetectorRegistry registry;
+	return registry;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// ENGINES /////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Gray, blur and threshold on 8-bit images, then skin filter (on the dark
+// pixels only), erosion, dilation and labeling at 1 bit per pixel
+class PackedEngine : public DetectorEngine
+{
+public:
+	int thresh, maxH, maxS, maxV, erosion, dilation;
+
+	PackedEngine( int thresh_, int erosion_, int dilation_ )
+		: thresh(thresh_), maxH(18), maxS(50), maxV(80), erosion(erosion_), dilation(dilation_) {}
+
+	const char* name() const { return "packed"; }
+
+	void detect( cv::Mat *frame, cv::Mat *mask, cv::Mat *skinView, std::vector<Blob> *blobs )
+	{
+		// mask receives the blurred gray image
+		cv::cvtColor( *frame, *mask, CV_RGB2GRAY );
+		stageDone( "gray", frame );
+		cv::blur( *mask, *mask, cv::Size(3,3) );
+		stageDone( "blur", frame );
+		packThresholdInv( mask, &dark, thresh );
+		stageDone( "threshold", frame );
+
+		packedSkinFilter( frame, &dark, &objMask, &hsv, maxH, maxS, maxV );
+		stageDone( "skin", frame );
+		if( skinView )
+		{
+			unpackMask( &objMask, skinView );
+			stageDone( "skin view", frame );
+		}
+
+		packedMorph( &objMask, &eroded, erosion, true );
+		stageDone( "erode", frame );
+		packedMorph( &eroded, &opened, dilation, false );
+		stageDone( "dilate", frame );
+		labelPackedMask( &opened, blobs, &runs, &labels );
+		stageDone( "labels", frame );
+	}
+
+private:
+	HsvTables hsv;
+	PackedMask dark, objMask, eroded, opened;
+	std::vector<Run> runs;
+	std::vector<int> labels;
+};
+
+// Same stages on runs of dark pixels; the skin filter only looks inside them
+class RleEngine : public DetectorEngine
+{
+public:
+	int thresh, maxH, maxS, maxV, erosion, dilation;
+
+	RleEngine( int thresh_, int erosion_, int dilation_ )
+		: thresh(thresh_), maxH(18), maxS(50), maxV(80), erosion(erosion_), dilation(dilation_) {}
+
+	const char* name() const { return "rle"; }
+
+	void detect( cv::Mat *frame, cv::Mat *mask, cv::Mat *skinView, std::vector<Blob> *blobs )
+	{
+		// mask receives the blurred gray image
+		cv::cvtColor( *frame, *mask, CV_RGB2GRAY );
+		stageDone( "gray", frame );
+		cv::blur( *mask, *mask, cv::Size(3,3) );
+		stageDone( "blur", frame );
+		rleThresholdInv( mask, &dark, thresh );
+		stageDone( "threshold", frame );
+
+		rleSubtractSkin( &dark, frame, &hsv, &objMask, maxH, maxS, maxV );
+		stageDone( "skin", frame );
+		if( skinView )
+		{
+			rleToMat( &objMask, skinView );
+			stageDone( "skin view", frame );
+		}
+
+		rleMorph( &objMask, &eroded, erosion, true );
+		stageDone( "erode", frame );
+		rleMorph( &eroded, &opened, dilation, false );
+		stageDone( "dilate", frame );
+		labelRleMask( &opened, blobs, &labels );
+		stageDone( "labels", frame );
+	}
+
+private:
+	HsvTables hsv;
+	RleMask dark, objMask, eroded, opened;
+	std::vector<int> labels;
+};
+
+// All per-pixel stages fused row by row, see ScanlinePipeline
+class StreamEngine : public DetectorEngine
+{
+public:
+	StreamEngine( int thresh, int erosion, int dilation ) : pipeline( thresh, erosion, dilation ) {}
+
+	const char* name() const { return "stream"; }
+
+	void detect( cv::Mat *frame, cv::Mat *mask, cv::Mat *skinView, std::vector<Blob> *blobs )
+	{
+		// The per-pixel stages share one loop over the rows, so they are
+		// counted together; the blobs are merged after it
+		pipeline.scan( frame, mask, skinView );
+		stageDone( "fused rows", frame );
+		pipeline.finish( blobs );
+		stageDone( "blob merge", frame );
+	}
+
+private:
+	ScanlinePipeline pipeline;
+};
+
+// Only the tiles that changed since the previous frame, see TilePipeline
+class TileEngine : public DetectorEngine
+{
+public:
+	TileEngine( int thresh, int erosion, int dilation ) : pipeline( thresh, erosion, dilation ) {}
+
+	const char* name() const { return "tiles"; }
+
+	void detect( cv::Mat *frame, cv::Mat *mask, cv::Mat *skinView, std::vector<Blob> *blobs )
+	{
+		pipeline.run( frame, mask, skinView, blobs );
+	}
+
+private:
+	TilePipeline pipeline;
+};
+
+// Row and column sums of the mask, see ProfileDetector; ambiguous frames go
+// through the fused pipeline
+class ProfileEngine : public DetectorEngine
+{
+public:
+	ProfileEngine( int thresh, int erosion, int dilation, double minArea )
+		: profiles( thresh, erosion, minArea ), pipeline( thresh, erosion, dilation ) {}
+
+	const char* name() const { return "profile"; }
+
+	void detect( cv::Mat *frame, cv::Mat *mask, cv::Mat *skinView, std::vector<Blob> *blobs )
+	{
+		if( !profiles.run( frame, mask, blobs ) ) pipeline.run( frame, mask, skinView, blobs );
+		else if( skinView ) mask->copyTo( *skinView );
+	}
+
+	void report( std::ostream &out ) const
+	{
+		out << "Profiles: " << profiles.fallbacks << " of " << profiles.frames
+			<< " frames ambiguous, sent to the full detector" << std::endl;
+	}
+
+private:
+	ProfileDetector profiles;
+	ScanlinePipeline pipeline;
+};
+
+// features2d SimpleBlobDetector on the gray frame: dark blobs over a range of
+// thresholds, no skin filter. Each keypoint becomes a disc of its diameter
+class SimpleBlobEngine : public DetectorEngine
+{
+public:
+	SimpleBlobEngine( int thresh, double minArea ) : detector( parameters( thresh, minArea ) ) {}
+
+	const char* name() const { return "simpleblob"; }
+
+	void detect( cv::Mat *frame, cv::Mat *mask, cv::Mat *, std::vector<Blob> *blobs )
+	{
+		cv::cvtColor( *frame, *mask, CV_RGB2GRAY );
+		detector.detect( *mask, keypoints );
+
+		blobs->resize( keypoints.size() );
+		for( size_t i = 0; i < keypoints.size(); i++ )
+		{
+			const cv::KeyPoint &k = keypoints[i];
+			double r = k.size / 2;
+			Blob &b = (*blobs)[i];
+			b.m00  = CV_PI * r * r;
+			b.m10  = b.m00 * k.pt.x;
+			b.m01  = b.m00 * k.pt.y;
+			b.minx = cvFloor( k.pt.x - r );
+			b.miny = cvFloor( k.pt.y - r );
+			b.maxx = cvCeil( k.pt.x + r );
+			b.maxy = cvCeil( k.pt.y + r );
+		}
+	}
+
+private:
+	cv::SimpleBlobDetector detector;
+	std::vector<cv::KeyPoint> keypoints;
+
+	static cv::SimpleBlobDetector::Params parameters( int thresh, double minArea )
+	{
+		cv::SimpleBlobDetector::Params p;
+		p.minThreshold        = 10;
+		p.maxThreshold        = (float)thresh + 1;
+		p.thresholdStep       = 5;
+		p.filterByColor       = true;
+		p.blobColor           = 0;
+		p.filterByArea        = true;
+		p.minArea             = (float)minArea;
+		p.maxArea             = 1e9f;
+		p.filterByCircularity = false;
+		p.filterByInertia     = false;
+		p.filterByConvexity   = false;
+		return p;
+	}
+};
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// COMPARISON HARNESS //////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+inline int biggestPair( const std::vector<Blob> *blobs, double minArea, cv::Point2f *pair )
+{
+	// Centers of the 2 biggest blobs above minArea; returns how many there are
+
+	std::vector<double> areas( blobs->size() );
+	for( size_t i = 0; i < blobs->size(); i++ )
+		areas[i] = ( (*blobs)[i].m00 > minArea ) ? (*blobs)[i].m00 : 0;
+
+	std::vector<int> top;
+	selectTopK( &areas, 2, &top );
+	for( size_t i = 0; i < top.size(); i++ ) pair[i] = (*blobs)[ top[i] ].center();
+	return (int)top.size();
+}
+
+inline void compareDetectors( cv::VideoCapture *video, const std::vector<DetectorEngine*> &engines,
+							  double minArea, double tolerance, std::ostream &out )
+{
+	// Runs every engine on each frame of the video and compares the centers
+	// of the 2 biggest objects with those of the first engine, whichever
+	// object each of them is. A frame agrees when both engines find the same
+	// number of objects (up to 2) and no center is more than tolerance away
+
+	size_t n = engines.size();
+	std::vector<double> seconds( n, 0 ), sumError( n, 0 ), maxError( n, 0 );
+	std::vector<int> found( n, 0 ), agree( n, 0 ), measured( n, 0 );
+	std::vector<Blob> blobs;
+	cv::Mat frame, mask;
+	cv::Point2f ref[2];
+	int frames = 0;
+
+	while( video->read( frame ) && !frame.empty() )
+	{
+		int refCount = 0;
+		for( size_t e = 0; e < n; e++ )
+		{
+			int64 t0 = cv::getTickCount();
+			engines[e]->detect( &frame, &mask, NULL, &blobs );
+			seconds[e] += ( cv::getTickCount() - t0 ) / cv::getTickFrequency();
+
+			cv::Point2f pair[2];
+			int count = biggestPair( &blobs, minArea, pair );
+			if( count == 2 ) found[e]++;
+			if( e == 0 )
+			{
+				refCount = count;
+				std::copy( pair, pair + 2, ref );
+			}
+			if( count != refCount ) continue;
+
+			// Error of the best assignment of the two centers
+			double error = 0;
+			if( count == 1 ) error = cv::norm( pair[0] - ref[0] );
+			if( count == 2 )
+			{
+				double straight = std::max( cv::norm( pair[0] - ref[0] ), cv::norm( pair[1] - ref[1] ) );
+				double swapped  = std::max( cv::norm( pair[0] - ref[1] ), cv::norm( pair[1] - ref[0] ) );
+				error = std::min( straight, swapped );
+			}
+			if( count > 0 )
+			{
+				sumError[e] += error;
+				maxError[e]  = std::max( maxError[e], error );
+				measured[e]++;
+			}
+			if( error <= tolerance ) agree[e]++;
+		}
+		frames++;
+	}
+
+	out << "Detectors on " << frames << " frames, centers compared with " << engines[0]->name()
+		<< " (agreement within " << tolerance << " px)" << std::endl;
+	out << std::setw(12) << "engine" << std::setw(10) << "ms/frame" << std::setw(10) << "found"
+		<< std::setw(10) << "agree" << std::setw(12) << "mean error" << std::setw(12) << "max error" << std::endl;
+
+	for( size_t e = 0; e < n; e++ )
+	{
+		double perFrame = frames ? 1.0 / frames : 0;
+		out << std::fixed << std::setprecision(2)
+			<< std::setw(12) << engines[e]->name()
+			<< std::setw(10) << seconds[e] * 1000 * perFrame
+			<< std::setw(9) << found[e] * 100 * perFrame << "%"
+			<< std::setw(9) << agree[e] * 100 * perFrame << "%"
+			<< std::setw(12) << ( measured[e] ? sumError[e] / measured[e] : 0 )
+			<< std::setw(12) << maxError[e] << std::endl;
+	}
+}
+
+#endif
@@ -0,0 +1,168 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// AOSS Vision Module - Marco Lancini (www.marcolancini.it)
+//
+//
+// Copyright (C) 2012 Marco Lancini
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef AOSS_DISPLAY_HPP
+#define AOSS_DISPLAY_HPP
+
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include "AOSS_Trajectory.hpp"
+#include "AOSS_Outlines.hpp"
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// DISPLAY RECORD //////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// What the windows need from one analyzed frame. The images are handed over,
+// not shared, so the analysis can go on reusing its own buffers.
+struct DisplayRecord
+{
+	int frameNum;
+	double timestamp;
+	cv::Mat frame;                                  // Frame under test
+	cv::Mat skin;                                   // Skin filter view
+	OutlineArena selected;                          // Polygons of the 2 objects, if any
+	bool found1, found2;                            // Box and center below are valid
+	cv::Rect box1, box2;
+	cv::Point2f c1, c2;
+	int p1x, p1y, p2x, p2y;
+	std::vector<std::vector<TrackSample> > paths;   // Recent positions of each object
+	std::vector<cv::Point> table;                   // Table polygon, empty if not in use
+};
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// DISPLAY THREAD //////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Owns every HighGUI call. The analysis asks wantsFrame() after each frame
+// and only builds a full record when a render is due, at most `hz` times per
+// second; frames in between are skipped. The escape key is reported by
+// quitRequested(), the T key (detect the table again) by
+// recalibrationRequested().
+class DisplayThread
+{
+public:
+	typedef std::function<void()> Setup;
+	typedef std::function<void( const DisplayRecord& )> Render;
+
+	DisplayThread() : running(false), hungry(false), quit(false), recalibrate(false), pending(false), rendered(0) {}
+	~DisplayThread() { stop(); }
+
+	void start( double hz, Setup setup, Render render )
+	{
+		period  = std::chrono::microseconds( (long long)( 1e6 / hz ) );
+		running = true;
+		worker  = std::thread( &DisplayThread::loop, this, setup, render );
+	}
+
+	void stop()
+	{
+		running = false;
+		if( worker.joinable() ) worker.join();
+	}
+
+	// Analysis side
+	bool wantsFrame() const    { return hungry.load( std::memory_order_relaxed ); }
+	bool quitRequested() const { return quit.load( std::memory_order_relaxed ); }
+	bool recalibrationRequested() { return recalibrate.exchange( false ); }
+
+	void post( DisplayRecord *record )
+	{
+		std::lock_guard<std::mutex> guard( lock );
+		std::swap( next, *record );
+		pending = true;
+		hungry  = false;
+	}
+
+	long long renderedFrames() const { return rendered; }
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	std::thread worker;
+	std::chrono::microseconds period;
+	std::atomic<bool> running, hungry, quit, recalibrate;
+
+	std::mutex lock;                // Guards next and pending
+	DisplayRecord next;
+	bool pending;
+
+	std::atomic<long long> rendered;
+
+	void loop( Setup setup, Render render )
+	{
+		// Windows must be created, drawn and polled from the same thread
+		setup();
+
+		DisplayRecord current;
+		Clock::time_point due = Clock::now();
+
+		while( running )
+		{
+			Clock::time_point now = Clock::now();
+			int wait = 1;
+			if( now < due ) wait = std::max( 1, (int)std::chrono::duration_cast<std::chrono::milliseconds>( due - now ).count() );
+
+			// Sleeping in waitKey keeps the windows responsive
+			int key = cvWaitKey( wait ) & 255;
+			if( key == 27 ) quit = true;
+			if( key == 't' || key == 'T' ) recalibrate = true;
+			if( Clock::now() < due ) continue;
+
+			bool have;
+			{
+				std::lock_guard<std::mutex> guard( lock );
+				have = pending;
+				if( have )
+				{
+					std::swap( current, next );
+					pending = false;
+				}
+				else hungry = true;
+			}
+			if( !have ) continue;
+
+			due = Clock::now() + period;
+			render( current );
+			rendered++;
+		}
+	}
+};
+
+#endif
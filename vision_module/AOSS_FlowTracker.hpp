@@ -0,0 +1,196 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// AOSS Vision Module - Marco Lancini (www.marcolancini.it)
+//
+//
+// Copyright (C) 2012 Marco Lancini
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef AOSS_FLOW_TRACKER_HPP
+#define AOSS_FLOW_TRACKER_HPP
+
+#include <vector>
+#include <algorithm>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/video/tracking.hpp>
+
+#include "AOSS_Follower.hpp"
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// FLOW TRACKER ////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Follows the detected objects between two full detections. seed() puts a
+// handful of corners on each object; every following frame, track() moves
+// them with pyramidal Lucas-Kanade and shifts each object by the median motion
+// of its corners. Each corner is also tracked back to the previous frame: an
+// object whose median forward-backward error passes `fbLimit`, or that keeps
+// fewer than `minPoints` corners, makes track() fail, and the caller runs the
+// detector again. The detector also runs every `interval` frames anyway.
+class FlowTracker : public Follower
+{
+public:
+	int interval;                   // Frames between two full detections
+	int maxCorners;                 // Corners seeded per object
+	double fbLimit;                 // Largest median forward-backward error, pixels
+	int minPoints;                  // Fewest corners an object may keep
+
+	int tracked, detections, failures;  // Statistics
+
+	explicit FlowTracker( int interval_ )
+		: interval(interval_), maxCorners(20), fbLimit(1.0), minPoints(4),
+		  tracked(0), detections(0), failures(0), since(0) {}
+
+	bool due() const { return objects.empty() || since >= interval; }
+	void reset() { objects.clear(); }
+
+	void report( std::ostream &out ) const
+	{
+		out << "Optical flow: " << tracked << " frames tracked, " << detections << " detections, "
+			<< failures << " lost";
+	}
+
+	void seed( const cv::Mat *frame, const std::vector<cv::Rect> *boxes,
+			   const std::vector<cv::Point2f> *centers, const std::vector<double> *areas )
+	{
+		// Objects just found by the detector, in frame coordinates. An object
+		// without enough corners leaves nothing to track until the next detection
+
+		cv::cvtColor( *frame, prevGray, CV_BGR2GRAY );
+		objects.clear();
+		detections++;
+		since = 0;
+
+		for( size_t i = 0; i < boxes->size(); i++ )
+		{
+			// Corners of the outline lie on the border of the box
+			cv::Rect r = cv::Rect( (*boxes)[i].x - 4, (*boxes)[i].y - 4, (*boxes)[i].width + 8, (*boxes)[i].height + 8 )
+						 & cv::Rect( 0, 0, frame->cols, frame->rows );
+			if( r.area() == 0 ) { objects.clear(); return; }
+
+			Object o;
+			cv::Mat roi = prevGray( r );
+			cv::goodFeaturesToTrack( roi, o.points, maxCorners, 0.01, 3 );
+			if( (int)o.points.size() < minPoints ) { objects.clear(); return; }
+
+			for( size_t j = 0; j < o.points.size(); j++ ) o.points[j] += cv::Point2f( (float)r.x, (float)r.y );
+			o.center = (*centers)[i];
+			o.box    = (*boxes)[i];
+			o.shift  = cv::Point2f();
+			o.area   = (*areas)[i];
+			objects.push_back( o );
+		}
+	}
+
+	bool track( const cv::Mat *frame, std::vector<cv::Point2f> *centers, std::vector<cv::Rect> *boxes, std::vector<double> *areas )
+	{
+		// Returns false, and forgets the objects, when the detector must run
+
+		cv::cvtColor( *frame, gray, CV_BGR2GRAY );
+
+		prevPts.clear();
+		for( size_t i = 0; i < objects.size(); i++ )
+			prevPts.insert( prevPts.end(), objects[i].points.begin(), objects[i].points.end() );
+
+		cv::calcOpticalFlowPyrLK( prevGray, gray, prevPts, nextPts, status, err, cv::Size(15, 15), 2 );
+		cv::calcOpticalFlowPyrLK( gray, prevGray, nextPts, backPts, backStatus, err, cv::Size(15, 15), 2 );
+		cv::swap( prevGray, gray );
+
+		centers->clear();
+		boxes->clear();
+		areas->clear();
+
+		size_t base = 0;
+		for( size_t i = 0; i < objects.size(); i++ )
+		{
+			Object &o = objects[i];
+			size_t n = o.points.size();
+
+			kept.clear();
+			dx.clear();
+			dy.clear();
+			fb.clear();
+			for( size_t j = base; j < base + n; j++ )
+			{
+				if( !status[j] || !backStatus[j] ) continue;
+				cv::Point2f back = backPts[j] - prevPts[j];
+				fb.push_back( std::sqrt( back.x * back.x + back.y * back.y ) );
+				if( fb.back() > fbLimit ) continue;
+
+				kept.push_back( nextPts[j] );
+				dx.push_back( nextPts[j].x - prevPts[j].x );
+				dy.push_back( nextPts[j].y - prevPts[j].y );
+			}
+			base += n;
+
+			if( (int)kept.size() < minPoints || median( &fb ) > fbLimit )
+			{
+				failures++;
+				objects.clear();
+				return false;
+			}
+
+			cv::Point2f d( median( &dx ), median( &dy ) );
+			o.points.swap( kept );
+			o.center += d;
+			o.shift  += d;
+
+			centers->push_back( o.center );
+			boxes->push_back( o.box + cv::Point( cvRound( o.shift.x ), cvRound( o.shift.y ) ) );
+			areas->push_back( o.area );
+		}
+
+		tracked++;
+		since++;
+		return true;
+	}
+
+private:
+	struct Object
+	{
+		std::vector<cv::Point2f> points;
+		cv::Point2f center;
+		cv::Rect box;                   // At the last detection
+		cv::Point2f shift;              // Motion since the last detection
+		double area;
+	};
+
+	std::vector<Object> objects;
+	int since;                      // Frames tracked since the last detection
+	cv::Mat prevGray, gray;
+
+	std::vector<cv::Point2f> prevPts, nextPts, backPts, kept;
+	std::vector<uchar> status, backStatus;
+	std::vector<float> err, dx, dy, fb;
+
+	static float median( std::vector<float> *v )
+	{
+		if( v->empty() ) return 0;
+		std::nth_element( v->begin(), v->begin() + v->size() / 2, v->end() );
+		return (*v)[ v->size() / 2 ];
+	}
+};
+
+#endif
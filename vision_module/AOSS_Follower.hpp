@@ -0,0 +1,61 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// AOSS Vision Module - Marco Lancini (www.marcolancini.it)
+//
+//
+// Copyright (C) 2012 Marco Lancini
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef AOSS_FOLLOWER_HPP
+#define AOSS_FOLLOWER_HPP
+
+#include <vector>
+#include <ostream>
+
+#include <opencv2/core/core.hpp>
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// FOLLOWER ////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Something cheaper than the detector that moves the detected objects from
+// one frame to the next. The detector runs whenever due() says so and hands
+// its objects to seed(); on the other frames track() gives their new centers,
+// boxes and areas, or fails and the detector runs instead. All positions are
+// in frame coordinates.
+class Follower
+{
+public:
+	virtual ~Follower() {}
+
+	virtual bool due() const = 0;
+	virtual void seed( const cv::Mat *frame, const std::vector<cv::Rect> *boxes,
+					   const std::vector<cv::Point2f> *centers, const std::vector<double> *areas ) = 0;
+	virtual bool track( const cv::Mat *frame, std::vector<cv::Point2f> *centers,
+						std::vector<cv::Rect> *boxes, std::vector<double> *areas ) = 0;
+
+	// One line of statistics for the end of the run
+	virtual void report( std::ostream &out ) const = 0;
+};
+
+#endif
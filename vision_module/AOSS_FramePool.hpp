@@ -0,0 +1,247 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// AOSS Vision Module - Marco Lancini (www.marcolancini.it)
+//
+//
+// Copyright (C) 2012 Marco Lancini
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef AOSS_FRAME_POOL_HPP
+#define AOSS_FRAME_POOL_HPP
+
+#include <vector>
+#include <iostream>
+#include <mutex>
+#include <cstdlib>
+#include <new>
+#include <stdint.h>
+
+#include <opencv2/core/core.hpp>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// FRAME POOL //////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Recycled image buffers, handed to OpenCV as a MatAllocator: a Mat whose
+// allocator points here takes its data from the pool on create(), and the
+// buffer goes back to the pool, from whatever thread, when the last Mat
+// sharing it is released. The Mat reference count lives in the buffer header,
+// so Mats are the handles and copying one shares the buffer.
+//
+// Buffers have a fixed size, enough for one frame, and their data starts on a
+// 64-byte boundary. Bigger requests are served and freed one by one, and
+// counted apart. The pool must outlive every Mat it allocated.
+
+struct FramePoolStats
+{
+	uint64_t hits;                  // Served by a recycled buffer
+	uint64_t misses;                // A new buffer had to be made
+	uint64_t oversize;              // Bigger than a buffer, not pooled
+	int inUse;                      // Buffers held by some Mat now
+	int highWater;                  // Most buffers in use at the same time
+	int buffers;                    // Buffers made so far
+	int hugeBuffers;                // Of those, the ones on huge pages
+};
+
+class FramePool : public cv::MatAllocator
+{
+public:
+	// hugePages asks for buffers on 2 MB pages (Linux only): reserved ones if
+	// the system has some, transparent ones otherwise
+	explicit FramePool( size_t bufferBytes, bool hugePages = false ) : bytes(bufferBytes), huge(hugePages)
+	{
+		s.hits = s.misses = s.oversize = 0;
+		s.inUse = s.highWater = s.buffers = s.hugeBuffers = 0;
+	}
+
+	~FramePool()
+	{
+		for( size_t i = 0; i < spare.size(); i++ ) destroy( spare[i] );
+	}
+
+	void allocate( int dims, const int* sizes, int type, int*& refcount, uchar*& datastart, uchar*& data, size_t* step )
+	{
+		size_t total = CV_ELEM_SIZE( type );
+		for( int i = dims - 1; i >= 0; i-- )
+		{
+			step[i] = total;
+			total  *= sizes[i];
+		}
+
+		Block *b = take( total );
+		b->refcount = 1;
+		refcount  = &b->refcount;
+		datastart = data = (uchar*)b + HEADER;
+	}
+
+	void deallocate( int* /*refcount*/, uchar* datastart, uchar* /*data*/ )
+	{
+		Block *b = (Block*)( datastart - HEADER );
+		if( !b->pooled )
+		{
+			destroy( b );
+			return;
+		}
+
+		std::lock_guard<std::mutex> guard( lock );
+		spare.push_back( b );
+		s.inUse--;
+	}
+
+	// A Mat of the given size and type taking its data from the pool
+	cv::Mat get( cv::Size size, int type )
+	{
+		cv::Mat m;
+		m.allocator = this;
+		m.create( size, type );
+		return m;
+	}
+
+	FramePoolStats stats()
+	{
+		std::lock_guard<std::mutex> guard( lock );
+		return s;
+	}
+
+	void report( std::ostream &out )
+	{
+		FramePoolStats st = stats();
+		out << "Frame pool: " << st.hits << " hits, " << st.misses << " misses, " << st.oversize << " oversize, "
+			<< st.buffers << " buffers of " << bytes / 1024 << " KB (" << st.hugeBuffers << " on huge pages), at most "
+			<< st.highWater << " in use" << std::endl;
+	}
+
+private:
+	enum { HEADER = 64, ALIGN = 64 };
+
+	// Sits in the first HEADER bytes of each buffer
+	struct Block
+	{
+		int refcount;               // Of the Mats sharing the data
+		bool pooled;                // Fixed size, goes back to the free list
+		size_t mapped;              // Length of the mapping, 0 if from malloc
+		void *base;                 // What malloc returned
+	};
+
+	size_t bytes;
+	bool huge;
+
+	std::mutex lock;                // Guards spare and s
+	std::vector<Block*> spare;   // Buffers back from their Mats
+	FramePoolStats s;
+
+	Block* take( size_t total )
+	{
+		if( total > bytes )
+		{
+			Block *b = make( total, false );
+			std::lock_guard<std::mutex> guard( lock );
+			s.oversize++;
+			return b;
+		}
+
+		{
+			std::lock_guard<std::mutex> guard( lock );
+			s.inUse++;
+			s.highWater = std::max( s.highWater, s.inUse );
+			if( !spare.empty() )
+			{
+				Block *b = spare.back();
+				spare.pop_back();
+				s.hits++;
+				return b;
+			}
+			s.misses++;
+		}
+		return make( bytes, true );
+	}
+
+	Block* make( size_t total, bool pooled )
+	{
+		size_t length = HEADER + total;
+		Block *b = NULL;
+
+#if defined(__linux__) && defined(MAP_HUGETLB)
+		if( huge && pooled )
+		{
+			const size_t page = 2 << 20;
+			size_t mapped = ( length + page - 1 ) / page * page;
+
+			// Reserved huge pages, else ordinary pages the kernel may merge
+			void *p = mmap( NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 );
+			bool reserved = ( p != MAP_FAILED );
+			if( !reserved ) p = mmap( NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+			if( p != MAP_FAILED )
+			{
+#if defined(MADV_HUGEPAGE)
+				if( !reserved ) madvise( p, mapped, MADV_HUGEPAGE );
+#endif
+				b = (Block*)p;
+				b->mapped = mapped;
+				b->base   = p;
+
+				std::lock_guard<std::mutex> guard( lock );
+				s.hugeBuffers += reserved;
+			}
+		}
+#endif
+
+		if( !b )
+		{
+			void *p = malloc( length + ALIGN - 1 );
+			if( !p ) throw std::bad_alloc();
+			b = (Block*)( ( (size_t)p + ALIGN - 1 ) & ~(size_t)( ALIGN - 1 ) );
+			b->mapped = 0;
+			b->base   = p;
+		}
+
+		b->pooled = pooled;
+		if( pooled )
+		{
+			std::lock_guard<std::mutex> guard( lock );
+			s.buffers++;
+		}
+		return b;
+	}
+
+	static void destroy( Block *b )
+	{
+#if defined(__linux__)
+		if( b->mapped )
+		{
+			munmap( b->base, b->mapped );
+			return;
+		}
+#endif
+		::free( b->base );
+	}
+
+	FramePool( const FramePool& );
+	FramePool& operator=( const FramePool& );
+};
+
+#endif
@@ -0,0 +1,1410 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// AOSS Vision Module - Marco Lancini (www.marcolancini.it)
+//
+//
+// Copyright (C) 2012 Marco Lancini
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef AOSS_KERNELS_HPP
+#define AOSS_KERNELS_HPP
+
+#include <cstring>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define AOSS_HAVE_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define AOSS_HAVE_NEON 1
+#include <arm_neon.h>
+#if defined(__arm__) && defined(__linux__)
+#include <sys/auxv.h>
+#ifndef HWCAP_NEON
+#define HWCAP_NEON (1 << 12)
+#endif
+#endif
+#endif
+
+typedef unsigned char uchar;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// KERNEL TABLE ////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Hand-written pixel kernels, one table per instruction set.
+// Binary rows hold 0 / 255; padded rows carry `radius` extra pixels on each side.
+struct PixelKernels
+{
+	const char *name;
+
+	// dst bit j of word w = ( src[w*64+j] <= thresh ), padding bits cleared
+	void (*thresholdBits)( const uchar *src, uint64_t *dst, int cols, int thresh );
+
+	// dst = a AND NOT b
+	void (*andNotWords)( const uint64_t *a, const uint64_t *b, uint64_t *dst, size_t n );
+
+	// dst &= src, dst |= src
+	void (*andRow)( uchar *dst, const uchar *src, int n );
+	void (*orRow)( uchar *dst, const uchar *src, int n );
+
+	// out[x] = AND / OR of padded[x .. x+2*radius]
+	void (*erodeRowH)( const uchar *padded, uchar *out, int cols, int radius );
+	void (*dilateRowH)( const uchar *padded, uchar *out, int cols, int radius );
+
+	// out[j] = distance from (px, py) to (x[j], y[j])
+	void (*distanceRow)( const float *x, const float *y, float px, float py, float *out, int n );
+
+	// colSums[x] += ( mask[x] != 0 ) for a 0 / 255 mask; returns the set pixels of the row
+	int (*profileRow)( const uchar *mask, uint16_t *colSums, int cols );
+
+	// First x >= from where row[x] != 0, or cols if there is none
+	int (*nextSet)( const uchar *row, int from, int cols );
+
+	// Area and first moments of closed polygons stored one after the other:
+	// polygon p is points offsets[p] .. offsets[p+1]-1 of xy (x, y pairs,
+	// coordinates below 32768). m00, m10 and m01 match cv::moments() up to
+	// rounding, as it sums in another order; the variants agree exactly
+	void (*polygonMoments)( const int *xy, const int *offsets, int polygons, double *m00, double *m10, double *m01 );
+
+	// Writes the indexes j where v[j] > min, in order; returns how many
+	int (*selectAbove)( const float *v, int n, float min, int *idx );
+
+	// gray[x] = grayPixel( bgr + 3*x )
+	void (*grayRow)( const uchar *bgr, uchar *gray, int cols );
+
+	// dark[x] = 255 where the 3x3 box blur, rounded as blur() does, is <= thresh.
+	// The gray rows carry 1 reflected pixel on each side: dark[x] reads x .. x+2
+	void (*blurThresholdRow)( const uchar *g0, const uchar *g1, const uchar *g2, uchar *dark, int cols, int thresh );
+
+	// Packed rows: out[w] = AND / OR of word w shifted by -radius .. radius
+	// bits. padded holds a fill word, the words words, and another fill word
+	void (*erodeWordsH)( const uint64_t *padded, uint64_t *out, int words, int radius );
+	void (*dilateWordsH)( const uint64_t *padded, uint64_t *out, int words, int radius );
+};
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// SCALAR (REFERENCE) //////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+inline void thresholdBitsScalar( const uchar *src, uint64_t *dst, int cols, int thresh )
+{
+	for( int x0 = 0, w = 0; x0 < cols; x0 += 64, w++ )
+	{
+		int n = ( cols - x0 < 64 ) ? cols - x0 : 64;
+		uint64_t word = 0;
+		for( int j = 0; j < n; j++ )
+			word |= (uint64_t)( src[x0 + j] <= thresh ) << j;
+		dst[w] = word;
+	}
+}
+
+inline void andNotWordsScalar( const uint64_t *a, const uint64_t *b, uint64_t *dst, size_t n )
+{
+	for( size_t i = 0; i < n; i++ ) dst[i] = a[i] & ~b[i];
+}
+
+inline void andRowScalar( uchar *dst, const uchar *src, int n ) { for( int i = 0; i < n; i++ ) dst[i] &= src[i]; }
+inline void orRowScalar( uchar *dst, const uchar *src, int n )  { for( int i = 0; i < n; i++ ) dst[i] |= src[i]; }
+
+inline void erodeRowHScalar( const uchar *padded, uchar *out, int cols, int radius )
+{
+	for( int x = 0; x < cols; x++ )
+	{
+		uchar m = padded[x];
+		for( int k = 1; k <= 2*radius; k++ ) m &= padded[x + k];
+		out[x] = m;
+	}
+}
+
+inline void dilateRowHScalar( const uchar *padded, uchar *out, int cols, int radius )
+{
+	for( int x = 0; x < cols; x++ )
+	{
+		uchar m = padded[x];
+		for( int k = 1; k <= 2*radius; k++ ) m |= padded[x + k];
+		out[x] = m;
+	}
+}
+
+inline void distanceRowScalar( const float *x, const float *y, float px, float py, float *out, int n )
+{
+	for( int j = 0; j < n; j++ )
+	{
+		float dx = x[j] - px, dy = y[j] - py;
+		out[j] = std::sqrt( dx*dx + dy*dy );
+	}
+}
+
+inline int profileRowScalar( const uchar *mask, uint16_t *colSums, int cols )
+{
+	int n = 0;
+	for( int x = 0; x < cols; x++ )
+	{
+		int b = mask[x] & 1;
+		colSums[x] += b;
+		n += b;
+	}
+	return n;
+}
+
+inline int nextSetScalar( const uchar *row, int x, int cols )
+{
+	// Eight clear pixels at a time
+	for( ; x + 8 <= cols; x += 8 )
+	{
+		uint64_t w;
+		memcpy( &w, row + x, 8 );
+		if( w ) break;
+	}
+	while( x < cols && !row[x] ) x++;
+	return x;
+}
+
+inline void polygonEdgesScalar( const int *xy, int n, int from, int64_t *s )
+{
+	// Adds the Green's theorem terms of the edges from point `from` on, the
+	// closing one included: the doubled area, and the same weighted by x and y
+
+	for( int j = from; j < n; j++ )
+	{
+		const int *p = xy + 2*j, *q = ( j + 1 < n ) ? p + 2 : xy;
+		int64_t a = (int64_t)p[0] * q[1] - (int64_t)q[0] * p[1];
+		s[0] += a;
+		s[1] += a * ( p[0] + q[0] );
+		s[2] += a * ( p[1] + q[1] );
+	}
+}
+
+inline void polygonFinish( const int64_t *s, double *m00, double *m10, double *m01 )
+{
+	// Either orientation gives a positive area, as with cv::moments()
+	double sign = ( s[0] < 0 ) ? -1 : 1;
+	*m00 = sign * s[0] / 2;
+	*m10 = sign * s[1] / 6;
+	*m01 = sign * s[2] / 6;
+}
+
+inline void polygonMomentsScalar( const int *xy, const int *offsets, int polygons, double *m00, double *m10, double *m01 )
+{
+	for( int p = 0; p < polygons; p++ )
+	{
+		int64_t s[3] = { 0, 0, 0 };
+		polygonEdgesScalar( xy + 2*offsets[p], offsets[p + 1] - offsets[p], 0, s );
+		polygonFinish( s, m00 + p, m10 + p, m01 + p );
+	}
+}
+
+inline int selectAboveScalar( const float *v, int n, float min, int *idx )
+{
+	// Every index is written, the count only moves past the kept ones
+	int k = 0;
+	for( int j = 0; j < n; j++ )
+	{
+		idx[k] = j;
+		k += ( v[j] > min );
+	}
+	return k;
+}
+
+inline uchar grayPixel( const uchar *p )
+{
+	// Fixed point CV_RGB2GRAY, weights applied in channel order as cvtColor does
+	return (uchar)( ( p[0]*4899 + p[1]*9617 + p[2]*1868 + (1 << 13) ) >> 14 );
+}
+
+inline void grayRowScalar( const uchar *bgr, uchar *gray, int cols )
+{
+	for( int x = 0; x < cols; x++ ) gray[x] = grayPixel( bgr + 3*x );
+}
+
+inline void blurThresholdRowScalar( const uchar *g0, const uchar *g1, const uchar *g2, uchar *dark, int cols, int thresh )
+{
+	for( int x = 0; x < cols; x++ )
+	{
+		int sum = g0[x] + g0[x + 1] + g0[x + 2]
+				+ g1[x] + g1[x + 1] + g1[x + 2]
+				+ g2[x] + g2[x + 1] + g2[x + 2];
+		dark[x] = ( ( sum + 4 ) / 9 <= thresh ) ? 255 : 0;
+	}
+}
+
+inline void erodeWordsHScalar( const uint64_t *padded, uint64_t *out, int words, int radius )
+{
+	// Bit j of the word shifted by k holds the pixel at column j+k
+	const uint64_t *p = padded + 1;
+	for( int w = 0; w < words; w++ )
+	{
+		uint64_t acc = p[w];
+		for( int k = 1; k <= radius; k++ )
+			acc &= ( ( p[w] >> k ) | ( p[w + 1] << ( 64 - k ) ) ) & ( ( p[w] << k ) | ( p[w - 1] >> ( 64 - k ) ) );
+		out[w] = acc;
+	}
+}
+
+inline void dilateWordsHScalar( const uint64_t *padded, uint64_t *out, int words, int radius )
+{
+	const uint64_t *p = padded + 1;
+	for( int w = 0; w < words; w++ )
+	{
+		uint64_t acc = p[w];
+		for( int k = 1; k <= radius; k++ )
+			acc |= ( p[w] >> k ) | ( p[w + 1] << ( 64 - k ) ) | ( p[w] << k ) | ( p[w - 1] >> ( 64 - k ) );
+		out[w] = acc;
+	}
+}
+
+inline const PixelKernels* scalarKernels()
+{
+	static const PixelKernels k = { "scalar", thresholdBitsScalar, andNotWordsScalar, andRowScalar, orRowScalar,
+									erodeRowHScalar, dilateRowHScalar, distanceRowScalar, profileRowScalar, nextSetScalar,
+									polygonMomentsScalar, selectAboveScalar,
+									grayRowScalar, blurThresholdRowScalar, erodeWordsHScalar, dilateWordsHScalar };
+	return &k;
+}
+
+
+
+#ifdef AOSS_HAVE_X86
+////////////////////////////////////////////////////////////////////////////////
+// SSE2 ////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+__attribute__((target("sse2")))
+inline void thresholdBitsSSE2( const uchar *src, uint64_t *dst, int cols, int thresh )
+{
+	const __m128i t = _mm_set1_epi8( (char)thresh );
+	int x = 0, w = 0;
+	for( ; x + 64 <= cols; x += 64, w++ )
+	{
+		uint64_t word = 0;
+		for( int j = 0; j < 4; j++ )
+		{
+			__m128i v  = _mm_loadu_si128( (const __m128i*)( src + x + 16*j ) );
+			__m128i le = _mm_cmpeq_epi8( _mm_min_epu8( v, t ), v );        // v <= t, unsigned
+			word |= (uint64_t)(unsigned)_mm_movemask_epi8( le ) << ( 16*j );
+		}
+		dst[w] = word;
+	}
+	if( x < cols ) thresholdBitsScalar( src + x, dst + w, cols - x, thresh );
+}
+
+__attribute__((target("sse2")))
+inline void andNotWordsSSE2( const uint64_t *a, const uint64_t *b, uint64_t *dst, size_t n )
+{
+	size_t i = 0;
+	for( ; i + 2 <= n; i += 2 )
+	{
+		__m128i va = _mm_loadu_si128( (const __m128i*)( a + i ) );
+		__m128i vb = _mm_loadu_si128( (const __m128i*)( b + i ) );
+		_mm_storeu_si128( (__m128i*)( dst + i ), _mm_andnot_si128( vb, va ) );
+	}
+	for( ; i < n; i++ ) dst[i] = a[i] & ~b[i];
+}
+
+__attribute__((target("sse2")))
+inline void andRowSSE2( uchar *dst, const uchar *src, int n )
+{
+	int i = 0;
+	for( ; i + 16 <= n; i += 16 )
+		_mm_storeu_si128( (__m128i*)( dst + i ), _mm_and_si128( _mm_loadu_si128( (const __m128i*)( dst + i ) ), _mm_loadu_si128( (const __m128i*)( src + i ) ) ) );
+	for( ; i < n; i++ ) dst[i] &= src[i];
+}
+
+__attribute__((target("sse2")))
+inline void orRowSSE2( uchar *dst, const uchar *src, int n )
+{
+	int i = 0;
+	for( ; i + 16 <= n; i += 16 )
+		_mm_storeu_si128( (__m128i*)( dst + i ), _mm_or_si128( _mm_loadu_si128( (const __m128i*)( dst + i ) ), _mm_loadu_si128( (const __m128i*)( src + i ) ) ) );
+	for( ; i < n; i++ ) dst[i] |= src[i];
+}
+
+__attribute__((target("sse2")))
+inline void erodeRowHSSE2( const uchar *padded, uchar *out, int cols, int radius )
+{
+	int x = 0;
+	for( ; x + 16 <= cols; x += 16 )
+	{
+		__m128i m = _mm_loadu_si128( (const __m128i*)( padded + x ) );
+		for( int k = 1; k <= 2*radius; k++ ) m = _mm_and_si128( m, _mm_loadu_si128( (const __m128i*)( padded + x + k ) ) );
+		_mm_storeu_si128( (__m128i*)( out + x ), m );
+	}
+	if( x < cols ) erodeRowHScalar( padded + x, out + x, cols - x, radius );
+}
+
+__attribute__((target("sse2")))
+inline void dilateRowHSSE2( const uchar *padded, uchar *out, int cols, int radius )
+{
+	int x = 0;
+	for( ; x + 16 <= cols; x += 16 )
+	{
+		__m128i m = _mm_loadu_si128( (const __m128i*)( padded + x ) );
+		for( int k = 1; k <= 2*radius; k++ ) m = _mm_or_si128( m, _mm_loadu_si128( (const __m128i*)( padded + x + k ) ) );
+		_mm_storeu_si128( (__m128i*)( out + x ), m );
+	}
+	if( x < cols ) dilateRowHScalar( padded + x, out + x, cols - x, radius );
+}
+
+__attribute__((target("sse2")))
+inline void distanceRowSSE2( const float *x, const float *y, float px, float py, float *out, int n )
+{
+	const __m128 vx = _mm_set1_ps( px ), vy = _mm_set1_ps( py );
+	int j = 0;
+	for( ; j + 4 <= n; j += 4 )
+	{
+		__m128 dx = _mm_sub_ps( _mm_loadu_ps( x + j ), vx );
+		__m128 dy = _mm_sub_ps( _mm_loadu_ps( y + j ), vy );
+		_mm_storeu_ps( out + j, _mm_sqrt_ps( _mm_add_ps( _mm_mul_ps( dx, dx ), _mm_mul_ps( dy, dy ) ) ) );
+	}
+	if( j < n ) distanceRowScalar( x + j, y + j, px, py, out + j, n - j );
+}
+
+__attribute__((target("sse2")))
+inline int profileRowSSE2( const uchar *mask, uint16_t *colSums, int cols )
+{
+	const __m128i one = _mm_set1_epi8( 1 ), zero = _mm_setzero_si128();
+	__m128i count = zero;
+	int x = 0;
+	for( ; x + 16 <= cols; x += 16 )
+	{
+		__m128i m = _mm_and_si128( _mm_loadu_si128( (const __m128i*)( mask + x ) ), one );
+		count = _mm_add_epi64( count, _mm_sad_epu8( m, zero ) );
+		__m128i *c = (__m128i*)( colSums + x );
+		_mm_storeu_si128( c,     _mm_add_epi16( _mm_loadu_si128( c ),     _mm_unpacklo_epi8( m, zero ) ) );
+		_mm_storeu_si128( c + 1, _mm_add_epi16( _mm_loadu_si128( c + 1 ), _mm_unpackhi_epi8( m, zero ) ) );
+	}
+	int n = _mm_cvtsi128_si32( count ) + _mm_cvtsi128_si32( _mm_srli_si128( count, 8 ) );
+	if( x < cols ) n += profileRowScalar( mask + x, colSums + x, cols - x );
+	return n;
+}
+
+__attribute__((target("sse2")))
+inline int nextSetSSE2( const uchar *row, int x, int cols )
+{
+	const __m128i zero = _mm_setzero_si128();
+	for( ; x + 16 <= cols; x += 16 )
+	{
+		unsigned clear = _mm_movemask_epi8( _mm_cmpeq_epi8( _mm_loadu_si128( (const __m128i*)( row + x ) ), zero ) );
+		if( clear != 0xFFFF ) return x + __builtin_ctz( ~clear );
+	}
+	return nextSetScalar( row, x, cols );
+}
+
+__attribute__((target("sse2")))
+inline void polygonMomentsSSE2( const int *xy, const int *offsets, int polygons, double *m00, double *m10, double *m01 )
+{
+	// 4 edges at a time: the points and the next ones are packed to 16 bits,
+	// so that one multiply-add gives x*y' - x'*y for each edge
+	const __m128i negY = _mm_set1_epi32( (int)0xFFFF0000 );
+
+	for( int p = 0; p < polygons; p++ )
+	{
+		const int *pts = xy + 2*offsets[p];
+		int n = offsets[p + 1] - offsets[p];
+		__m128d sa = _mm_setzero_pd(), sx = sa, sy = sa;
+		int j = 0;
+		for( ; j + 4 < n; j += 4 )
+		{
+			__m128i c0 = _mm_loadu_si128( (const __m128i*)( pts + 2*j ) ), c1 = _mm_loadu_si128( (const __m128i*)( pts + 2*j + 4 ) );
+			__m128i n0 = _mm_loadu_si128( (const __m128i*)( pts + 2*j + 2 ) ), n1 = _mm_loadu_si128( (const __m128i*)( pts + 2*j + 6 ) );
+
+			__m128i next = _mm_packs_epi32( n0, n1 );
+			next = _mm_shufflehi_epi16( _mm_shufflelo_epi16( next, _MM_SHUFFLE(2,3,0,1) ), _MM_SHUFFLE(2,3,0,1) );
+			next = _mm_sub_epi16( _mm_xor_si128( next, negY ), negY );
+			__m128i a = _mm_madd_epi16( _mm_packs_epi32( c0, c1 ), next );
+
+			// x + x' and y + y' of the 4 edges
+			__m128i t0 = _mm_shuffle_epi32( _mm_add_epi32( c0, n0 ), _MM_SHUFFLE(3,1,2,0) );
+			__m128i t1 = _mm_shuffle_epi32( _mm_add_epi32( c1, n1 ), _MM_SHUFFLE(3,1,2,0) );
+			__m128i ex = _mm_unpacklo_epi64( t0, t1 ), ey = _mm_unpackhi_epi64( t0, t1 );
+
+			__m128d aLo = _mm_cvtepi32_pd( a ), aHi = _mm_cvtepi32_pd( _mm_srli_si128( a, 8 ) );
+			sa = _mm_add_pd( sa, _mm_add_pd( aLo, aHi ) );
+			sx = _mm_add_pd( sx, _mm_add_pd( _mm_mul_pd( aLo, _mm_cvtepi32_pd( ex ) ), _mm_mul_pd( aHi, _mm_cvtepi32_pd( _mm_srli_si128( ex, 8 ) ) ) ) );
+			sy = _mm_add_pd( sy, _mm_add_pd( _mm_mul_pd( aLo, _mm_cvtepi32_pd( ey ) ), _mm_mul_pd( aHi, _mm_cvtepi32_pd( _mm_srli_si128( ey, 8 ) ) ) ) );
+		}
+
+		// The partial sums are whole numbers well below 2^53, so exact
+		double h[6];
+		_mm_storeu_pd( h, sa );
+		_mm_storeu_pd( h + 2, sx );
+		_mm_storeu_pd( h + 4, sy );
+		int64_t s[3] = { (int64_t)( h[0] + h[1] ), (int64_t)( h[2] + h[3] ), (int64_t)( h[4] + h[5] ) };
+		polygonEdgesScalar( pts, n, j, s );
+		polygonFinish( s, m00 + p, m10 + p, m01 + p );
+	}
+}
+
+__attribute__((target("sse2")))
+inline int selectAboveSSE2( const float *v, int n, float min, int *idx )
+{
+	const __m128 vmin = _mm_set1_ps( min );
+	int j = 0, k = 0;
+	for( ; j + 4 <= n; j += 4 )
+	{
+		int m = _mm_movemask_ps( _mm_cmpgt_ps( _mm_loadu_ps( v + j ), vmin ) );
+		idx[k] = j;     k += m & 1;
+		idx[k] = j + 1; k += ( m >> 1 ) & 1;
+		idx[k] = j + 2; k += ( m >> 2 ) & 1;
+		idx[k] = j + 3; k += ( m >> 3 ) & 1;
+	}
+	for( ; j < n; j++ )
+	{
+		idx[k] = j;
+		k += ( v[j] > min );
+	}
+	return k;
+}
+
+__attribute__((target("sse2")))
+inline void deinterleave32SSE2( const uchar *bgr, __m128i *c )
+{
+	// 32 pixels of 3 bytes into c[0..1], c[2..3], c[4..5], one pair per channel:
+	// five rounds of byte interleaving of the 6 loaded vectors
+	for( int i = 0; i < 6; i++ ) c[i] = _mm_loadu_si128( (const __m128i*)( bgr + 16*i ) );
+	for( int r = 0; r < 5; r++ )
+	{
+		__m128i l0 = c[0], l1 = c[1], l2 = c[2], l3 = c[3], l4 = c[4], l5 = c[5];
+		c[0] = _mm_unpacklo_epi8( l0, l3 );
+		c[1] = _mm_unpackhi_epi8( l0, l3 );
+		c[2] = _mm_unpacklo_epi8( l1, l4 );
+		c[3] = _mm_unpackhi_epi8( l1, l4 );
+		c[4] = _mm_unpacklo_epi8( l2, l5 );
+		c[5] = _mm_unpackhi_epi8( l2, l5 );
+	}
+}
+
+__attribute__((target("sse2")))
+inline __m128i gray8SSE2( __m128i c0, __m128i c1, __m128i c2 )
+{
+	// 8 pixels, 16-bit channels: c0*4899 + c1*9617 + c2*1868 + 2^13 in 32 bits
+	const __m128i w01 = _mm_set_epi16( 9617, 4899, 9617, 4899, 9617, 4899, 9617, 4899 );
+	const __m128i w2r = _mm_set_epi16( 8192, 1868, 8192, 1868, 8192, 1868, 8192, 1868 );
+	const __m128i one = _mm_set1_epi16( 1 );
+	__m128i lo = _mm_add_epi32( _mm_madd_epi16( _mm_unpacklo_epi16( c0, c1 ), w01 ), _mm_madd_epi16( _mm_unpacklo_epi16( c2, one ), w2r ) );
+	__m128i hi = _mm_add_epi32( _mm_madd_epi16( _mm_unpackhi_epi16( c0, c1 ), w01 ), _mm_madd_epi16( _mm_unpackhi_epi16( c2, one ), w2r ) );
+	return _mm_packs_epi32( _mm_srai_epi32( lo, 14 ), _mm_srai_epi32( hi, 14 ) );
+}
+
+__attribute__((target("sse2")))
+inline void grayRowSSE2( const uchar *bgr, uchar *gray, int cols )
+{
+	const __m128i z = _mm_setzero_si128();
+	int x = 0;
+	for( ; x + 32 <= cols; x += 32 )
+	{
+		__m128i c[6];
+		deinterleave32SSE2( bgr + 3*x, c );
+		for( int h = 0; h < 2; h++ )
+		{
+			__m128i lo = gray8SSE2( _mm_unpacklo_epi8( c[h], z ), _mm_unpacklo_epi8( c[2 + h], z ), _mm_unpacklo_epi8( c[4 + h], z ) );
+			__m128i hi = gray8SSE2( _mm_unpackhi_epi8( c[h], z ), _mm_unpackhi_epi8( c[2 + h], z ), _mm_unpackhi_epi8( c[4 + h], z ) );
+			_mm_storeu_si128( (__m128i*)( gray + x + 16*h ), _mm_packus_epi16( lo, hi ) );
+		}
+	}
+	if( x < cols ) grayRowScalar( bgr + 3*x, gray + x, cols - x );
+}
+
+__attribute__((target("sse2")))
+inline void blurThresholdRowSSE2( const uchar *g0, const uchar *g1, const uchar *g2, uchar *dark, int cols, int thresh )
+{
+	// (sum + 4) / 9 <= thresh is sum <= 9*thresh + 4, compared in 16 bits
+	const __m128i limit = _mm_set1_epi16( (short)( 9*thresh + 5 ) );
+	const __m128i z = _mm_setzero_si128();
+	const uchar *g[3] = { g0, g1, g2 };
+	int x = 0;
+	for( ; x + 16 <= cols; x += 16 )
+	{
+		__m128i lo = z, hi = z;
+		for( int r = 0; r < 3; r++ )
+			for( int k = 0; k < 3; k++ )
+			{
+				__m128i v = _mm_loadu_si128( (const __m128i*)( g[r] + x + k ) );
+				lo = _mm_add_epi16( lo, _mm_unpacklo_epi8( v, z ) );
+				hi = _mm_add_epi16( hi, _mm_unpackhi_epi8( v, z ) );
+			}
+		_mm_storeu_si128( (__m128i*)( dark + x ), _mm_packs_epi16( _mm_cmpgt_epi16( limit, lo ), _mm_cmpgt_epi16( limit, hi ) ) );
+	}
+	if( x < cols ) blurThresholdRowScalar( g0 + x, g1 + x, g2 + x, dark + x, cols - x, thresh );
+}
+
+__attribute__((target("sse2")))
+inline void erodeWordsHSSE2( const uint64_t *padded, uint64_t *out, int words, int radius )
+{
+	const uint64_t *p = padded + 1;
+	int w = 0;
+	for( ; w + 2 <= words; w += 2 )
+	{
+		__m128i cur  = _mm_loadu_si128( (const __m128i*)( p + w ) );
+		__m128i next = _mm_loadu_si128( (const __m128i*)( p + w + 1 ) );
+		__m128i prev = _mm_loadu_si128( (const __m128i*)( p + w - 1 ) );
+		__m128i acc = cur;
+		for( int k = 1; k <= radius; k++ )
+		{
+			__m128i n = _mm_cvtsi32_si128( k ), m = _mm_cvtsi32_si128( 64 - k );
+			acc = _mm_and_si128( acc, _mm_or_si128( _mm_srl_epi64( cur, n ), _mm_sll_epi64( next, m ) ) );
+			acc = _mm_and_si128( acc, _mm_or_si128( _mm_sll_epi64( cur, n ), _mm_srl_epi64( prev, m ) ) );
+		}
+		_mm_storeu_si128( (__m128i*)( out + w ), acc );
+	}
+	if( w < words ) erodeWordsHScalar( padded + w, out + w, words - w, radius );
+}
+
+__attribute__((target("sse2")))
+inline void dilateWordsHSSE2( const uint64_t *padded, uint64_t *out, int words, int radius )
+{
+	const uint64_t *p = padded + 1;
+	int w = 0;
+	for( ; w + 2 <= words; w += 2 )
+	{
+		__m128i cur  = _mm_loadu_si128( (const __m128i*)( p + w ) );
+		__m128i next = _mm_loadu_si128( (const __m128i*)( p + w + 1 ) );
+		__m128i prev = _mm_loadu_si128( (const __m128i*)( p + w - 1 ) );
+		__m128i acc = cur;
+		for( int k = 1; k <= radius; k++ )
+		{
+			__m128i n = _mm_cvtsi32_si128( k ), m = _mm_cvtsi32_si128( 64 - k );
+			acc = _mm_or_si128( acc, _mm_or_si128( _mm_srl_epi64( cur, n ), _mm_sll_epi64( next, m ) ) );
+			acc = _mm_or_si128( acc, _mm_or_si128( _mm_sll_epi64( cur, n ), _mm_srl_epi64( prev, m ) ) );
+		}
+		_mm_storeu_si128( (__m128i*)( out + w ), acc );
+	}
+	if( w < words ) dilateWordsHScalar( padded + w, out + w, words - w, radius );
+}
+
+inline const PixelKernels* sse2Kernels()
+{
+	static const PixelKernels k = { "sse2", thresholdBitsSSE2, andNotWordsSSE2, andRowSSE2, orRowSSE2,
+									erodeRowHSSE2, dilateRowHSSE2, distanceRowSSE2, profileRowSSE2, nextSetSSE2,
+									polygonMomentsSSE2, selectAboveSSE2,
+									grayRowSSE2, blurThresholdRowSSE2, erodeWordsHSSE2, dilateWordsHSSE2 };
+	return &k;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// AVX2 ////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+__attribute__((target("avx2")))
+inline void thresholdBitsAVX2( const uchar *src, uint64_t *dst, int cols, int thresh )
+{
+	const __m256i t = _mm256_set1_epi8( (char)thresh );
+	int x = 0, w = 0;
+	for( ; x + 64 <= cols; x += 64, w++ )
+	{
+		__m256i v0 = _mm256_loadu_si256( (const __m256i*)( src + x ) );
+		__m256i v1 = _mm256_loadu_si256( (const __m256i*)( src + x + 32 ) );
+		uint64_t lo = (uint32_t)_mm256_movemask_epi8( _mm256_cmpeq_epi8( _mm256_min_epu8( v0, t ), v0 ) );
+		uint64_t hi = (uint32_t)_mm256_movemask_epi8( _mm256_cmpeq_epi8( _mm256_min_epu8( v1, t ), v1 ) );
+		dst[w] = lo | ( hi << 32 );
+	}
+	if( x < cols ) thresholdBitsScalar( src + x, dst + w, cols - x, thresh );
+}
+
+__attribute__((target("avx2")))
+inline void andNotWordsAVX2( const uint64_t *a, const uint64_t *b, uint64_t *dst, size_t n )
+{
+	size_t i = 0;
+	for( ; i + 4 <= n; i += 4 )
+	{
+		__m256i va = _mm256_loadu_si256( (const __m256i*)( a + i ) );
+		__m256i vb = _mm256_loadu_si256( (const __m256i*)( b + i ) );
+		_mm256_storeu_si256( (__m256i*)( dst + i ), _mm256_andnot_si256( vb, va ) );
+	}
+	for( ; i < n; i++ ) dst[i] = a[i] & ~b[i];
+}
+
+__attribute__((target("avx2")))
+inline void andRowAVX2( uchar *dst, const uchar *src, int n )
+{
+	int i = 0;
+	for( ; i + 32 <= n; i += 32 )
+		_mm256_storeu_si256( (__m256i*)( dst + i ), _mm256_and_si256( _mm256_loadu_si256( (const __m256i*)( dst + i ) ), _mm256_loadu_si256( (const __m256i*)( src + i ) ) ) );
+	for( ; i < n; i++ ) dst[i] &= src[i];
+}
+
+__attribute__((target("avx2")))
+inline void orRowAVX2( uchar *dst, const uchar *src, int n )
+{
+	int i = 0;
+	for( ; i + 32 <= n; i += 32 )
+		_mm256_storeu_si256( (__m256i*)( dst + i ), _mm256_or_si256( _mm256_loadu_si256( (const __m256i*)( dst + i ) ), _mm256_loadu_si256( (const __m256i*)( src + i ) ) ) );
+	for( ; i < n; i++ ) dst[i] |= src[i];
+}
+
+__attribute__((target("avx2")))
+inline void erodeRowHAVX2( const uchar *padded, uchar *out, int cols, int radius )
+{
+	int x = 0;
+	for( ; x + 32 <= cols; x += 32 )
+	{
+		__m256i m = _mm256_loadu_si256( (const __m256i*)( padded + x ) );
+		for( int k = 1; k <= 2*radius; k++ ) m = _mm256_and_si256( m, _mm256_loadu_si256( (const __m256i*)( padded + x + k ) ) );
+		_mm256_storeu_si256( (__m256i*)( out + x ), m );
+	}
+	if( x < cols ) erodeRowHScalar( padded + x, out + x, cols - x, radius );
+}
+
+__attribute__((target("avx2")))
+inline void dilateRowHAVX2( const uchar *padded, uchar *out, int cols, int radius )
+{
+	int x = 0;
+	for( ; x + 32 <= cols; x += 32 )
+	{
+		__m256i m = _mm256_loadu_si256( (const __m256i*)( padded + x ) );
+		for( int k = 1; k <= 2*radius; k++ ) m = _mm256_or_si256( m, _mm256_loadu_si256( (const __m256i*)( padded + x + k ) ) );
+		_mm256_storeu_si256( (__m256i*)( out + x ), m );
+	}
+	if( x < cols ) dilateRowHScalar( padded + x, out + x, cols - x, radius );
+}
+
+__attribute__((target("avx2")))
+inline void distanceRowAVX2( const float *x, const float *y, float px, float py, float *out, int n )
+{
+	const __m256 vx = _mm256_set1_ps( px ), vy = _mm256_set1_ps( py );
+	int j = 0;
+	for( ; j + 8 <= n; j += 8 )
+	{
+		__m256 dx = _mm256_sub_ps( _mm256_loadu_ps( x + j ), vx );
+		__m256 dy = _mm256_sub_ps( _mm256_loadu_ps( y + j ), vy );
+		_mm256_storeu_ps( out + j, _mm256_sqrt_ps( _mm256_add_ps( _mm256_mul_ps( dx, dx ), _mm256_mul_ps( dy, dy ) ) ) );
+	}
+	if( j < n ) distanceRowScalar( x + j, y + j, px, py, out + j, n - j );
+}
+
+__attribute__((target("avx2")))
+inline int profileRowAVX2( const uchar *mask, uint16_t *colSums, int cols )
+{
+	const __m256i one = _mm256_set1_epi8( 1 ), zero = _mm256_setzero_si256();
+	__m256i count = zero;
+	int x = 0;
+	for( ; x + 32 <= cols; x += 32 )
+	{
+		__m256i m = _mm256_and_si256( _mm256_loadu_si256( (const __m256i*)( mask + x ) ), one );
+		count = _mm256_add_epi64( count, _mm256_sad_epu8( m, zero ) );
+		__m256i *c = (__m256i*)( colSums + x );
+		_mm256_storeu_si256( c,     _mm256_add_epi16( _mm256_loadu_si256( c ),     _mm256_cvtepu8_epi16( _mm256_castsi256_si128( m ) ) ) );
+		_mm256_storeu_si256( c + 1, _mm256_add_epi16( _mm256_loadu_si256( c + 1 ), _mm256_cvtepu8_epi16( _mm256_extracti128_si256( m, 1 ) ) ) );
+	}
+	__m128i half = _mm_add_epi64( _mm256_castsi256_si128( count ), _mm256_extracti128_si256( count, 1 ) );
+	int n = _mm_cvtsi128_si32( half ) + _mm_cvtsi128_si32( _mm_srli_si128( half, 8 ) );
+	if( x < cols ) n += profileRowScalar( mask + x, colSums + x, cols - x );
+	return n;
+}
+
+__attribute__((target("avx2")))
+inline int nextSetAVX2( const uchar *row, int x, int cols )
+{
+	const __m256i zero = _mm256_setzero_si256();
+	for( ; x + 32 <= cols; x += 32 )
+	{
+		unsigned clear = (unsigned)_mm256_movemask_epi8( _mm256_cmpeq_epi8( _mm256_loadu_si256( (const __m256i*)( row + x ) ), zero ) );
+		if( clear != 0xFFFFFFFFu ) return x + __builtin_ctz( ~clear );
+	}
+	return nextSetScalar( row, x, cols );
+}
+
+__attribute__((target("avx2")))
+inline void polygonMomentsAVX2( const int *xy, const int *offsets, int polygons, double *m00, double *m10, double *m01 )
+{
+	// As the SSE2 variant, 8 edges at a time. Packing works within each
+	// 128-bit half, which shuffles the edges, but the same way for the areas
+	// and for the sums of coordinates
+	const __m256i negY = _mm256_set1_epi32( (int)0xFFFF0000 );
+
+	for( int p = 0; p < polygons; p++ )
+	{
+		const int *pts = xy + 2*offsets[p];
+		int n = offsets[p + 1] - offsets[p];
+		__m256d sa = _mm256_setzero_pd(), sx = sa, sy = sa;
+		int j = 0;
+		for( ; j + 8 < n; j += 8 )
+		{
+			__m256i c0 = _mm256_loadu_si256( (const __m256i*)( pts + 2*j ) ), c1 = _mm256_loadu_si256( (const __m256i*)( pts + 2*j + 8 ) );
+			__m256i n0 = _mm256_loadu_si256( (const __m256i*)( pts + 2*j + 2 ) ), n1 = _mm256_loadu_si256( (const __m256i*)( pts + 2*j + 10 ) );
+
+			__m256i next = _mm256_packs_epi32( n0, n1 );
+			next = _mm256_shufflehi_epi16( _mm256_shufflelo_epi16( next, _MM_SHUFFLE(2,3,0,1) ), _MM_SHUFFLE(2,3,0,1) );
+			next = _mm256_sub_epi16( _mm256_xor_si256( next, negY ), negY );
+			__m256i a = _mm256_madd_epi16( _mm256_packs_epi32( c0, c1 ), next );
+
+			__m256i t0 = _mm256_shuffle_epi32( _mm256_add_epi32( c0, n0 ), _MM_SHUFFLE(3,1,2,0) );
+			__m256i t1 = _mm256_shuffle_epi32( _mm256_add_epi32( c1, n1 ), _MM_SHUFFLE(3,1,2,0) );
+			__m256i ex = _mm256_unpacklo_epi64( t0, t1 ), ey = _mm256_unpackhi_epi64( t0, t1 );
+
+			__m256d aLo = _mm256_cvtepi32_pd( _mm256_castsi256_si128( a ) ), aHi = _mm256_cvtepi32_pd( _mm256_extracti128_si256( a, 1 ) );
+			sa = _mm256_add_pd( sa, _mm256_add_pd( aLo, aHi ) );
+			sx = _mm256_add_pd( sx, _mm256_add_pd( _mm256_mul_pd( aLo, _mm256_cvtepi32_pd( _mm256_castsi256_si128( ex ) ) ),
+												   _mm256_mul_pd( aHi, _mm256_cvtepi32_pd( _mm256_extracti128_si256( ex, 1 ) ) ) ) );
+			sy = _mm256_add_pd( sy, _mm256_add_pd( _mm256_mul_pd( aLo, _mm256_cvtepi32_pd( _mm256_castsi256_si128( ey ) ) ),
+												   _mm256_mul_pd( aHi, _mm256_cvtepi32_pd( _mm256_extracti128_si256( ey, 1 ) ) ) ) );
+		}
+
+		double h[12];
+		_mm256_storeu_pd( h, sa );
+		_mm256_storeu_pd( h + 4, sx );
+		_mm256_storeu_pd( h + 8, sy );
+		int64_t s[3] = { (int64_t)( h[0] + h[1] + h[2] + h[3] ), (int64_t)( h[4] + h[5] + h[6] + h[7] ), (int64_t)( h[8] + h[9] + h[10] + h[11] ) };
+		polygonEdgesScalar( pts, n, j, s );
+		polygonFinish( s, m00 + p, m10 + p, m01 + p );
+	}
+}
+
+__attribute__((target("avx2")))
+inline int selectAboveAVX2( const float *v, int n, float min, int *idx )
+{
+	const __m256 vmin = _mm256_set1_ps( min );
+	int j = 0, k = 0;
+	for( ; j + 8 <= n; j += 8 )
+	{
+		int m = _mm256_movemask_ps( _mm256_cmp_ps( _mm256_loadu_ps( v + j ), vmin, _CMP_GT_OQ ) );
+		idx[k] = j;     k += m & 1;
+		idx[k] = j + 1; k += ( m >> 1 ) & 1;
+		idx[k] = j + 2; k += ( m >> 2 ) & 1;
+		idx[k] = j + 3; k += ( m >> 3 ) & 1;
+		idx[k] = j + 4; k += ( m >> 4 ) & 1;
+		idx[k] = j + 5; k += ( m >> 5 ) & 1;
+		idx[k] = j + 6; k += ( m >> 6 ) & 1;
+		idx[k] = j + 7; k += ( m >> 7 ) & 1;
+	}
+	for( ; j < n; j++ )
+	{
+		idx[k] = j;
+		k += ( v[j] > min );
+	}
+	return k;
+}
+
+__attribute__((target("avx2")))
+inline __m256i gray16AVX2( __m128i c0, __m128i c1, __m128i c2 )
+{
+	// 16 pixels of 8-bit channels; unpacks and packs both stay within the
+	// 128-bit lanes, so the pixels come out in order
+	const __m256i w01 = _mm256_set1_epi32( ( 9617 << 16 ) | 4899 );
+	const __m256i w2r = _mm256_set1_epi32( ( 8192 << 16 ) | 1868 );
+	const __m256i one = _mm256_set1_epi16( 1 );
+	__m256i a = _mm256_cvtepu8_epi16( c0 ), b = _mm256_cvtepu8_epi16( c1 ), c = _mm256_cvtepu8_epi16( c2 );
+	__m256i lo = _mm256_add_epi32( _mm256_madd_epi16( _mm256_unpacklo_epi16( a, b ), w01 ), _mm256_madd_epi16( _mm256_unpacklo_epi16( c, one ), w2r ) );
+	__m256i hi = _mm256_add_epi32( _mm256_madd_epi16( _mm256_unpackhi_epi16( a, b ), w01 ), _mm256_madd_epi16( _mm256_unpackhi_epi16( c, one ), w2r ) );
+	return _mm256_packs_epi32( _mm256_srai_epi32( lo, 14 ), _mm256_srai_epi32( hi, 14 ) );
+}
+
+__attribute__((target("avx2")))
+inline void grayRowAVX2( const uchar *bgr, uchar *gray, int cols )
+{
+	// No byte shuffle across the 128-bit lanes: the pixels are split into
+	// channels as in SSE2, the arithmetic is done 16 pixels at a time
+	int x = 0;
+	for( ; x + 32 <= cols; x += 32 )
+	{
+		__m128i c[6];
+		deinterleave32SSE2( bgr + 3*x, c );
+		__m256i g = _mm256_packus_epi16( gray16AVX2( c[0], c[2], c[4] ), gray16AVX2( c[1], c[3], c[5] ) );
+		_mm256_storeu_si256( (__m256i*)( gray + x ), _mm256_permute4x64_epi64( g, 0xD8 ) );
+	}
+	if( x < cols ) grayRowScalar( bgr + 3*x, gray + x, cols - x );
+}
+
+__attribute__((target("avx2")))
+inline void blurThresholdRowAVX2( const uchar *g0, const uchar *g1, const uchar *g2, uchar *dark, int cols, int thresh )
+{
+	const __m256i limit = _mm256_set1_epi16( (short)( 9*thresh + 5 ) );
+	const uchar *g[3] = { g0, g1, g2 };
+	int x = 0;
+	for( ; x + 32 <= cols; x += 32 )
+	{
+		__m256i lo = _mm256_setzero_si256(), hi = lo;
+		for( int r = 0; r < 3; r++ )
+			for( int k = 0; k < 3; k++ )
+			{
+				lo = _mm256_add_epi16( lo, _mm256_cvtepu8_epi16( _mm_loadu_si128( (const __m128i*)( g[r] + x + k ) ) ) );
+				hi = _mm256_add_epi16( hi, _mm256_cvtepu8_epi16( _mm_loadu_si128( (const __m128i*)( g[r] + x + 16 + k ) ) ) );
+			}
+		__m256i m = _mm256_packs_epi16( _mm256_cmpgt_epi16( limit, lo ), _mm256_cmpgt_epi16( limit, hi ) );
+		_mm256_storeu_si256( (__m256i*)( dark + x ), _mm256_permute4x64_epi64( m, 0xD8 ) );
+	}
+	if( x < cols ) blurThresholdRowSSE2( g0 + x, g1 + x, g2 + x, dark + x, cols - x, thresh );
+}
+
+__attribute__((target("avx2")))
+inline void erodeWordsHAVX2( const uint64_t *padded, uint64_t *out, int words, int radius )
+{
+	const uint64_t *p = padded + 1;
+	int w = 0;
+	for( ; w + 4 <= words; w += 4 )
+	{
+		__m256i cur  = _mm256_loadu_si256( (const __m256i*)( p + w ) );
+		__m256i next = _mm256_loadu_si256( (const __m256i*)( p + w + 1 ) );
+		__m256i prev = _mm256_loadu_si256( (const __m256i*)( p + w - 1 ) );
+		__m256i acc = cur;
+		for( int k = 1; k <= radius; k++ )
+		{
+			__m128i n = _mm_cvtsi32_si128( k ), m = _mm_cvtsi32_si128( 64 - k );
+			acc = _mm256_and_si256( acc, _mm256_or_si256( _mm256_srl_epi64( cur, n ), _mm256_sll_epi64( next, m ) ) );
+			acc = _mm256_and_si256( acc, _mm256_or_si256( _mm256_sll_epi64( cur, n ), _mm256_srl_epi64( prev, m ) ) );
+		}
+		_mm256_storeu_si256( (__m256i*)( out + w ), acc );
+	}
+	if( w < words ) erodeWordsHSSE2( padded + w, out + w, words - w, radius );
+}
+
+__attribute__((target("avx2")))
+inline void dilateWordsHAVX2( const uint64_t *padded, uint64_t *out, int words, int radius )
+{
+	const uint64_t *p = padded + 1;
+	int w = 0;
+	for( ; w + 4 <= words; w += 4 )
+	{
+		__m256i cur  = _mm256_loadu_si256( (const __m256i*)( p + w ) );
+		__m256i next = _mm256_loadu_si256( (const __m256i*)( p + w + 1 ) );
+		__m256i prev = _mm256_loadu_si256( (const __m256i*)( p + w - 1 ) );
+		__m256i acc = cur;
+		for( int k = 1; k <= radius; k++ )
+		{
+			__m128i n = _mm_cvtsi32_si128( k ), m = _mm_cvtsi32_si128( 64 - k );
+			acc = _mm256_or_si256( acc, _mm256_or_si256( _mm256_srl_epi64( cur, n ), _mm256_sll_epi64( next, m ) ) );
+			acc = _mm256_or_si256( acc, _mm256_or_si256( _mm256_sll_epi64( cur, n ), _mm256_srl_epi64( prev, m ) ) );
+		}
+		_mm256_storeu_si256( (__m256i*)( out + w ), acc );
+	}
+	if( w < words ) dilateWordsHSSE2( padded + w, out + w, words - w, radius );
+}
+
+inline const PixelKernels* avx2Kernels()
+{
+	static const PixelKernels k = { "avx2", thresholdBitsAVX2, andNotWordsAVX2, andRowAVX2, orRowAVX2,
+									erodeRowHAVX2, dilateRowHAVX2, distanceRowAVX2, profileRowAVX2, nextSetAVX2,
+									polygonMomentsAVX2, selectAboveAVX2,
+									grayRowAVX2, blurThresholdRowAVX2, erodeWordsHAVX2, dilateWordsHAVX2 };
+	return &k;
+}
+#endif
+
+
+
+#ifdef AOSS_HAVE_NEON
+////////////////////////////////////////////////////////////////////////////////
+// NEON ////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+inline unsigned movemaskNEON( uint8x16_t m )
+{
+	// One bit per 0xFF lane, lane 0 in bit 0
+	static const uint8_t weights[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+	uint8x16_t b = vandq_u8( m, vld1q_u8( weights ) );
+	uint8x8_t lo = vget_low_u8( b ), hi = vget_high_u8( b );
+	lo = vpadd_u8( lo, lo ); lo = vpadd_u8( lo, lo ); lo = vpadd_u8( lo, lo );
+	hi = vpadd_u8( hi, hi ); hi = vpadd_u8( hi, hi ); hi = vpadd_u8( hi, hi );
+	return vget_lane_u8( lo, 0 ) | ( vget_lane_u8( hi, 0 ) << 8 );
+}
+
+inline void thresholdBitsNEON( const uchar *src, uint64_t *dst, int cols, int thresh )
+{
+	const uint8x16_t t = vdupq_n_u8( (uint8_t)thresh );
+	int x = 0, w = 0;
+	for( ; x + 64 <= cols; x += 64, w++ )
+	{
+		uint64_t word = 0;
+		for( int j = 0; j < 4; j++ )
+			word |= (uint64_t)movemaskNEON( vcleq_u8( vld1q_u8( src + x + 16*j ), t ) ) << ( 16*j );
+		dst[w] = word;
+	}
+	if( x < cols ) thresholdBitsScalar( src + x, dst + w, cols - x, thresh );
+}
+
+inline void andNotWordsNEON( const uint64_t *a, const uint64_t *b, uint64_t *dst, size_t n )
+{
+	size_t i = 0;
+	for( ; i + 2 <= n; i += 2 )
+		vst1q_u64( (uint64_t*)( dst + i ), vbicq_u64( vld1q_u64( (const uint64_t*)( a + i ) ), vld1q_u64( (const uint64_t*)( b + i ) ) ) );
+	for( ; i < n; i++ ) dst[i] = a[i] & ~b[i];
+}
+
+inline void andRowNEON( uchar *dst, const uchar *src, int n )
+{
+	int i = 0;
+	for( ; i + 16 <= n; i += 16 ) vst1q_u8( dst + i, vandq_u8( vld1q_u8( dst + i ), vld1q_u8( src + i ) ) );
+	for( ; i < n; i++ ) dst[i] &= src[i];
+}
+
+inline void orRowNEON( uchar *dst, const uchar *src, int n )
+{
+	int i = 0;
+	for( ; i + 16 <= n; i += 16 ) vst1q_u8( dst + i, vorrq_u8( vld1q_u8( dst + i ), vld1q_u8( src + i ) ) );
+	for( ; i < n; i++ ) dst[i] |= src[i];
+}
+
+inline void erodeRowHNEON( const uchar *padded, uchar *out, int cols, int radius )
+{
+	int x = 0;
+	for( ; x + 16 <= cols; x += 16 )
+	{
+		uint8x16_t m = vld1q_u8( padded + x );
+		for( int k = 1; k <= 2*radius; k++ ) m = vandq_u8( m, vld1q_u8( padded + x + k ) );
+		vst1q_u8( out + x, m );
+	}
+	if( x < cols ) erodeRowHScalar( padded + x, out + x, cols - x, radius );
+}
+
+inline void dilateRowHNEON( const uchar *padded, uchar *out, int cols, int radius )
+{
+	int x = 0;
+	for( ; x + 16 <= cols; x += 16 )
+	{
+		uint8x16_t m = vld1q_u8( padded + x );
+		for( int k = 1; k <= 2*radius; k++ ) m = vorrq_u8( m, vld1q_u8( padded + x + k ) );
+		vst1q_u8( out + x, m );
+	}
+	if( x < cols ) dilateRowHScalar( padded + x, out + x, cols - x, radius );
+}
+
+inline void distanceRowNEON( const float *x, const float *y, float px, float py, float *out, int n )
+{
+	const float32x4_t vx = vdupq_n_f32( px ), vy = vdupq_n_f32( py );
+	int j = 0;
+	for( ; j + 4 <= n; j += 4 )
+	{
+		float32x4_t dx = vsubq_f32( vld1q_f32( x + j ), vx );
+		float32x4_t dy = vsubq_f32( vld1q_f32( y + j ), vy );
+		float32x4_t d2 = vaddq_f32( vmulq_f32( dx, dx ), vmulq_f32( dy, dy ) );
+#if defined(__aarch64__)
+		vst1q_f32( out + j, vsqrtq_f32( d2 ) );
+#else
+		// No vector square root on 32-bit ARM
+		float sq[4];
+		vst1q_f32( sq, d2 );
+		for( int i = 0; i < 4; i++ ) out[j + i] = std::sqrt( sq[i] );
+#endif
+	}
+	if( j < n ) distanceRowScalar( x + j, y + j, px, py, out + j, n - j );
+}
+
+inline int profileRowNEON( const uchar *mask, uint16_t *colSums, int cols )
+{
+	const uint8x16_t one = vdupq_n_u8( 1 );
+	uint32x4_t count = vdupq_n_u32( 0 );
+	int x = 0;
+	for( ; x + 16 <= cols; x += 16 )
+	{
+		uint8x16_t m = vandq_u8( vld1q_u8( mask + x ), one );
+		count = vpadalq_u16( count, vpaddlq_u8( m ) );
+		vst1q_u16( colSums + x,     vaddw_u8( vld1q_u16( colSums + x ),     vget_low_u8( m ) ) );
+		vst1q_u16( colSums + x + 8, vaddw_u8( vld1q_u16( colSums + x + 8 ), vget_high_u8( m ) ) );
+	}
+	uint64x2_t pairs = vpaddlq_u32( count );
+	int n = (int)( vgetq_lane_u64( pairs, 0 ) + vgetq_lane_u64( pairs, 1 ) );
+	if( x < cols ) n += profileRowScalar( mask + x, colSums + x, cols - x );
+	return n;
+}
+
+inline int nextSetNEON( const uchar *row, int x, int cols )
+{
+	for( ; x + 16 <= cols; x += 16 )
+	{
+		uint64x2_t w = vreinterpretq_u64_u8( vld1q_u8( row + x ) );
+		if( vgetq_lane_u64( w, 0 ) | vgetq_lane_u64( w, 1 ) ) break;
+	}
+	return nextSetScalar( row, x, cols );
+}
+
+inline void polygonMomentsNEON( const int *xy, const int *offsets, int polygons, double *m00, double *m10, double *m01 )
+{
+	// 4 edges at a time, x and y split by the loads; the products are
+	// widened to 64 bits, as there is no vector double on 32-bit ARM
+	for( int p = 0; p < polygons; p++ )
+	{
+		const int *pts = xy + 2*offsets[p];
+		int n = offsets[p + 1] - offsets[p];
+		int64x2_t sa = vdupq_n_s64( 0 ), sx = sa, sy = sa;
+		int j = 0;
+		for( ; j + 4 < n; j += 4 )
+		{
+			int32x4x2_t c = vld2q_s32( pts + 2*j ), d = vld2q_s32( pts + 2*j + 2 );
+			int32x4_t a  = vmlsq_s32( vmulq_s32( c.val[0], d.val[1] ), d.val[0], c.val[1] );
+			int32x4_t ex = vaddq_s32( c.val[0], d.val[0] ), ey = vaddq_s32( c.val[1], d.val[1] );
+			sa = vpadalq_s32( sa, a );
+			sx = vmlal_s32( vmlal_s32( sx, vget_low_s32( a ), vget_low_s32( ex ) ), vget_high_s32( a ), vget_high_s32( ex ) );
+			sy = vmlal_s32( vmlal_s32( sy, vget_low_s32( a ), vget_low_s32( ey ) ), vget_high_s32( a ), vget_high_s32( ey ) );
+		}
+
+		int64_t s[3] = { vgetq_lane_s64( sa, 0 ) + vgetq_lane_s64( sa, 1 ),
+						 vgetq_lane_s64( sx, 0 ) + vgetq_lane_s64( sx, 1 ),
+						 vgetq_lane_s64( sy, 0 ) + vgetq_lane_s64( sy, 1 ) };
+		polygonEdgesScalar( pts, n, j, s );
+		polygonFinish( s, m00 + p, m10 + p, m01 + p );
+	}
+}
+
+inline int selectAboveNEON( const float *v, int n, float min, int *idx )
+{
+	const float32x4_t vmin = vdupq_n_f32( min );
+	int j = 0, k = 0;
+	for( ; j + 4 <= n; j += 4 )
+	{
+		uint32_t m[4];
+		vst1q_u32( m, vshrq_n_u32( vcgtq_f32( vld1q_f32( v + j ), vmin ), 31 ) );
+		idx[k] = j;     k += m[0];
+		idx[k] = j + 1; k += m[1];
+		idx[k] = j + 2; k += m[2];
+		idx[k] = j + 3; k += m[3];
+	}
+	for( ; j < n; j++ )
+	{
+		idx[k] = j;
+		k += ( v[j] > min );
+	}
+	return k;
+}
+
+inline uint8x8_t gray8NEON( uint8x8_t c0, uint8x8_t c1, uint8x8_t c2 )
+{
+	uint16x8_t a = vmovl_u8( c0 ), b = vmovl_u8( c1 ), c = vmovl_u8( c2 );
+	uint32x4_t lo = vdupq_n_u32( 1 << 13 ), hi = lo;
+	lo = vmlal_n_u16( lo, vget_low_u16( a ), 4899 );
+	lo = vmlal_n_u16( lo, vget_low_u16( b ), 9617 );
+	lo = vmlal_n_u16( lo, vget_low_u16( c ), 1868 );
+	hi = vmlal_n_u16( hi, vget_high_u16( a ), 4899 );
+	hi = vmlal_n_u16( hi, vget_high_u16( b ), 9617 );
+	hi = vmlal_n_u16( hi, vget_high_u16( c ), 1868 );
+	return vmovn_u16( vcombine_u16( vshrn_n_u32( lo, 14 ), vshrn_n_u32( hi, 14 ) ) );
+}
+
+inline void grayRowNEON( const uchar *bgr, uchar *gray, int cols )
+{
+	int x = 0;
+	for( ; x + 16 <= cols; x += 16 )
+	{
+		uint8x16x3_t c = vld3q_u8( bgr + 3*x );
+		vst1_u8( gray + x,     gray8NEON( vget_low_u8( c.val[0] ),  vget_low_u8( c.val[1] ),  vget_low_u8( c.val[2] ) ) );
+		vst1_u8( gray + x + 8, gray8NEON( vget_high_u8( c.val[0] ), vget_high_u8( c.val[1] ), vget_high_u8( c.val[2] ) ) );
+	}
+	if( x < cols ) grayRowScalar( bgr + 3*x, gray + x, cols - x );
+}
+
+inline void blurThresholdRowNEON( const uchar *g0, const uchar *g1, const uchar *g2, uchar *dark, int cols, int thresh )
+{
+	const uint16x8_t limit = vdupq_n_u16( (uint16_t)( 9*thresh + 4 ) );
+	const uchar *g[3] = { g0, g1, g2 };
+	int x = 0;
+	for( ; x + 16 <= cols; x += 16 )
+	{
+		uint16x8_t lo = vdupq_n_u16( 0 ), hi = lo;
+		for( int r = 0; r < 3; r++ )
+			for( int k = 0; k < 3; k++ )
+			{
+				uint8x16_t v = vld1q_u8( g[r] + x + k );
+				lo = vaddw_u8( lo, vget_low_u8( v ) );
+				hi = vaddw_u8( hi, vget_high_u8( v ) );
+			}
+		vst1q_u8( dark + x, vcombine_u8( vmovn_u16( vcleq_u16( lo, limit ) ), vmovn_u16( vcleq_u16( hi, limit ) ) ) );
+	}
+	if( x < cols ) blurThresholdRowScalar( g0 + x, g1 + x, g2 + x, dark + x, cols - x, thresh );
+}
+
+inline void erodeWordsHNEON( const uint64_t *padded, uint64_t *out, int words, int radius )
+{
+	// vshlq_u64 shifts right for negative counts
+	const uint64_t *p = padded + 1;
+	int w = 0;
+	for( ; w + 2 <= words; w += 2 )
+	{
+		uint64x2_t cur = vld1q_u64( p + w ), next = vld1q_u64( p + w + 1 ), prev = vld1q_u64( p + w - 1 );
+		uint64x2_t acc = cur;
+		for( int k = 1; k <= radius; k++ )
+		{
+			int64x2_t l = vdupq_n_s64( k ), r = vdupq_n_s64( -k ), l2 = vdupq_n_s64( 64 - k ), r2 = vdupq_n_s64( k - 64 );
+			acc = vandq_u64( acc, vorrq_u64( vshlq_u64( cur, r ), vshlq_u64( next, l2 ) ) );
+			acc = vandq_u64( acc, vorrq_u64( vshlq_u64( cur, l ), vshlq_u64( prev, r2 ) ) );
+		}
+		vst1q_u64( out + w, acc );
+	}
+	if( w < words ) erodeWordsHScalar( padded + w, out + w, words - w, radius );
+}
+
+inline void dilateWordsHNEON( const uint64_t *padded, uint64_t *out, int words, int radius )
+{
+	const uint64_t *p = padded + 1;
+	int w = 0;
+	for( ; w + 2 <= words; w += 2 )
+	{
+		uint64x2_t cur = vld1q_u64( p + w ), next = vld1q_u64( p + w + 1 ), prev = vld1q_u64( p + w - 1 );
+		uint64x2_t acc = cur;
+		for( int k = 1; k <= radius; k++ )
+		{
+			int64x2_t l = vdupq_n_s64( k ), r = vdupq_n_s64( -k ), l2 = vdupq_n_s64( 64 - k ), r2 = vdupq_n_s64( k - 64 );
+			acc = vorrq_u64( acc, vorrq_u64( vshlq_u64( cur, r ), vshlq_u64( next, l2 ) ) );
+			acc = vorrq_u64( acc, vorrq_u64( vshlq_u64( cur, l ), vshlq_u64( prev, r2 ) ) );
+		}
+		vst1q_u64( out + w, acc );
+	}
+	if( w < words ) dilateWordsHScalar( padded + w, out + w, words - w, radius );
+}
+
+inline const PixelKernels* neonKernels()
+{
+	static const PixelKernels k = { "neon", thresholdBitsNEON, andNotWordsNEON, andRowNEON, orRowNEON,
+									erodeRowHNEON, dilateRowHNEON, distanceRowNEON, profileRowNEON, nextSetNEON,
+									polygonMomentsNEON, selectAboveNEON,
+									grayRowNEON, blurThresholdRowNEON, erodeWordsHNEON, dilateWordsHNEON };
+	return &k;
+}
+#endif
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// DISPATCH ////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+inline void availableKernels( std::vector<const PixelKernels*> *list )
+{
+	// Every variant this CPU can run, scalar first and best last
+
+	list->clear();
+	list->push_back( scalarKernels() );
+
+#ifdef AOSS_HAVE_X86
+	__builtin_cpu_init();
+	if( __builtin_cpu_supports( "sse2" ) ) list->push_back( sse2Kernels() );
+	if( __builtin_cpu_supports( "avx2" ) ) list->push_back( avx2Kernels() );
+#endif
+
+#ifdef AOSS_HAVE_NEON
+#if defined(__arm__) && defined(__linux__)
+	if( getauxval( AT_HWCAP ) & HWCAP_NEON )
+#endif
+		list->push_back( neonKernels() );
+#endif
+}
+
+inline const PixelKernels** kernelSlot()
+{
+	static const PixelKernels *active = 0;
+	return &active;
+}
+
+inline bool selectKernels( const std::string &name )
+{
+	// Picks a variant by name, or the best available one for "auto".
+	// Call once at startup, before any frame is processed
+
+	std::vector<const PixelKernels*> list;
+	availableKernels( &list );
+
+	if( name == "auto" )
+	{
+		*kernelSlot() = list.back();
+		return true;
+	}
+	for( size_t i = 0; i < list.size(); i++ )
+	{
+		if( name == list[i]->name )
+		{
+			*kernelSlot() = list[i];
+			return true;
+		}
+	}
+	return false;
+}
+
+inline const PixelKernels* kernels()
+{
+	if( !*kernelSlot() ) selectKernels( "auto" );
+	return *kernelSlot();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// SELF-TEST ///////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+inline bool selfTestKernels()
+{
+	// Runs every available variant against the scalar reference on random
+	// frames, with widths that exercise the vector tails
+
+	const int widths[] = { 1, 15, 16, 17, 31, 33, 63, 64, 65, 127, 640, 1921 };
+	const int nWidths  = sizeof(widths) / sizeof(widths[0]);
+	const int rows     = 24;
+	const int radius   = 3;
+
+	std::vector<const PixelKernels*> list;
+	availableKernels( &list );
+	const PixelKernels *ref = scalarKernels();
+
+	uint32_t seed = 2463534242u;
+	bool allOk = true;
+
+	for( size_t v = 1; v < list.size(); v++ )
+	{
+		const PixelKernels *k = list[v];
+		bool ok = true;
+
+		for( int wi = 0; wi < nWidths && ok; wi++ )
+		{
+			int cols  = widths[wi];
+			int words = ( cols + 63 ) / 64;
+
+			std::vector<uchar> gray( cols ), bin( cols + 2*radius ), a( cols ), b( cols );
+			std::vector<uchar> bgr( 3*cols ), g3( 3*( cols + 2 ) );
+			std::vector<uint64_t> w1( words ), w2( words ), wa( words ), wb( words ), wp( words + 2 );
+			std::vector<float> px( cols ), py( cols ), da( cols ), db( cols );
+			std::vector<uint16_t> sa( cols, 0 ), sb( cols, 0 );
+
+			for( int y = 0; y < rows && ok; y++ )
+			{
+				for( int x = 0; x < cols; x++ )
+				{
+					seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+					gray[x] = (uchar)seed;
+				}
+				for( int x = 0; x < cols + 2*radius; x++ )
+				{
+					seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+					bin[x] = ( seed & 3 ) ? 255 : 0;
+				}
+				int thresh = gray[0];
+
+				ref->thresholdBits( &gray[0], &w1[0], cols, thresh );
+				k->thresholdBits( &gray[0], &w2[0], cols, thresh );
+				ok = ok && w1 == w2;
+
+				ref->andNotWords( &w1[0], &w2[0], &wa[0], words );
+				k->andNotWords( &w1[0], &w2[0], &wb[0], words );
+				ok = ok && wa == wb;
+
+				ref->erodeRowH( &bin[0], &a[0], cols, radius );
+				k->erodeRowH( &bin[0], &b[0], cols, radius );
+				ok = ok && a == b;
+
+				ref->dilateRowH( &bin[0], &a[0], cols, radius );
+				k->dilateRowH( &bin[0], &b[0], cols, radius );
+				ok = ok && a == b;
+
+				ref->andRow( &a[0], &gray[0], cols );
+				k->andRow( &b[0], &gray[0], cols );
+				ok = ok && a == b;
+
+				ref->orRow( &a[0], &bin[0], cols );
+				k->orRow( &b[0], &bin[0], cols );
+				ok = ok && a == b;
+
+				// Centers on a 1080p frame; a fused multiply-add in either
+				// variant may move the last bit
+				for( int x = 0; x < cols; x++ )
+				{
+					px[x] = gray[x] * 7.5f + 0.25f * ( x & 3 );
+					py[x] = bin[x] * 4.2f + 0.5f * ( x % 5 );
+				}
+				ref->distanceRow( &px[0], &py[0], px[0], py[0], &da[0], cols );
+				k->distanceRow( &px[0], &py[0], px[0], py[0], &db[0], cols );
+				for( int x = 0; x < cols; x++ ) ok = ok && std::fabs( da[x] - db[x] ) <= 1e-5f * ( 1 + da[x] );
+
+				// Column sums accumulate over the rows
+				ok = ok && ref->profileRow( &bin[0], &sa[0], cols ) == k->profileRow( &bin[0], &sb[0], cols );
+				ok = ok && sa == sb;
+
+				// From every start, over a sparse row
+				for( int x = 0; x < cols; x++ ) a[x] = ( gray[x] < 4 ) ? 255 : 0;
+				for( int x = 0; x <= cols; x += 7 ) ok = ok && ref->nextSet( &a[0], x, cols ) == k->nextSet( &a[0], x, cols );
+
+				// Areas with a few at the threshold, which are not kept
+				for( int x = 0; x < cols; x++ ) px[x] = (float)( gray[x] & 63 );
+				std::vector<int> ia( cols ), ib( cols );
+				int na = ref->selectAbove( &px[0], cols, 40, &ia[0] ), nb = k->selectAbove( &px[0], cols, 40, &ib[0] );
+				ok = ok && na == nb && std::equal( ia.begin(), ia.begin() + na, ib.begin() );
+
+				// Color pixels, including the extremes of every channel
+				for( int i = 0; i < 3*cols; i++ )
+				{
+					seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+					bgr[i] = ( seed & 7 ) ? (uchar)( seed >> 8 ) : ( ( seed & 8 ) ? 255 : 0 );
+				}
+				ref->grayRow( &bgr[0], &a[0], cols );
+				k->grayRow( &bgr[0], &b[0], cols );
+				ok = ok && a == b;
+
+				// Three padded gray rows, dark enough for both outcomes
+				for( int i = 0; i < 3*( cols + 2 ); i++ ) g3[i] = bgr[ i % ( 3*cols ) ] & 127;
+				const uchar *r0 = &g3[0], *r1 = r0 + cols + 2, *r2 = r1 + cols + 2;
+				ref->blurThresholdRow( r0, r1, r2, &a[0], cols, thresh & 127 );
+				k->blurThresholdRow( r0, r1, r2, &b[0], cols, thresh & 127 );
+				ok = ok && a == b;
+
+				// Packed rows with both fill words, every radius class
+				for( int w = 0; w < words + 2; w++ )
+				{
+					seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+					wp[w] = ( (uint64_t)seed << 32 ) ^ ( seed * 2654435761u );
+				}
+				wp[0] = ~(uint64_t)0;
+				wp[words + 1] = 0;
+				const int radii[] = { 1, radius, 31, 63 };
+				for( int r = 0; r < 4; r++ )
+				{
+					ref->erodeWordsH( &wp[0], &wa[0], words, radii[r] );
+					k->erodeWordsH( &wp[0], &wb[0], words, radii[r] );
+					ok = ok && wa == wb;
+
+					ref->dilateWordsH( &wp[0], &wa[0], words, radii[r] );
+					k->dilateWordsH( &wp[0], &wb[0], words, radii[r] );
+					ok = ok && wa == wb;
+				}
+			}
+
+			// Polygons of every length up to cols, one after the other,
+			// wandering over a 1080p frame
+			std::vector<int> xy, offsets( 1, 0 );
+			int polygons = std::min( cols, 70 );
+			for( int p = 0; p < polygons; p++ )
+			{
+				for( int j = 0; j < p; j++ )
+				{
+					seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+					xy.push_back( seed % 1920 );
+					xy.push_back( ( seed >> 12 ) % 1080 );
+				}
+				offsets.push_back( (int)xy.size() / 2 );
+			}
+			xy.resize( xy.size() + 2 );     // Nothing is read past the last point, but &xy[0] must exist
+			std::vector<double> ma( 3*polygons ), mb( 3*polygons );
+			ref->polygonMoments( &xy[0], &offsets[0], polygons, &ma[0], &ma[polygons], &ma[2*polygons] );
+			k->polygonMoments( &xy[0], &offsets[0], polygons, &mb[0], &mb[polygons], &mb[2*polygons] );
+			ok = ok && ma == mb;
+		}
+
+		std::cout << "Kernels " << k->name << ": " << ( ok ? "OK" : "MISMATCH" ) << std::endl;
+		allOk = allOk && ok;
+	}
+
+	return allOk;
+}
+
+#endif
@@ -0,0 +1,110 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// AOSS Vision Module - Marco Lancini (www.marcolancini.it)
+//
+//
+// Copyright (C) 2012 Marco Lancini
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef AOSS_OBJECTS_HPP
+#define AOSS_OBJECTS_HPP
+
+#include <vector>
+#include <algorithm>
+
+#include <opencv2/core/core.hpp>
+
+#include "AOSS_Kernels.hpp"
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// TOP K ///////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+template<typename T>
+inline void selectTopK( const std::vector<T> *areas, int k, std::vector<int> *idx )
+{
+	// Indexes of the k biggest positive areas, biggest first; fewer if there
+	// are not enough. A partial selection, so linear in the number of
+	// contours plus k log k for the final order. Equal areas keep the lower
+	// index first
+
+	idx->clear();
+	for( size_t i = 0; i < areas->size(); i++ )
+		if( (*areas)[i] > 0 ) idx->push_back( (int)i );
+
+	struct Bigger
+	{
+		const std::vector<T> *a;
+		bool operator()( int i, int j ) const { return (*a)[i] != (*a)[j] ? (*a)[i] > (*a)[j] : i < j; }
+	} bigger = { areas };
+
+	if( k < (int)idx->size() )
+	{
+		std::nth_element( idx->begin(), idx->begin() + k, idx->end(), bigger );
+		idx->resize( k );
+	}
+	std::sort( idx->begin(), idx->end(), bigger );
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// PAIRWISE DISTANCES //////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Distances between every pair of a set of centers, as a full n x n matrix
+// computed a row at a time by the distanceRow kernel. Centers are kept as
+// separate x and y arrays so the kernel reads them with plain vector loads.
+class PairwiseDistances
+{
+public:
+	PairwiseDistances() : n(0) {}
+
+	void compute( const std::vector<cv::Point2f> *centers )
+	{
+		n = (int)centers->size();
+		xs.resize( n );
+		ys.resize( n );
+		d.resize( (size_t)n * n );
+
+		for( int i = 0; i < n; i++ )
+		{
+			xs[i] = (*centers)[i].x;
+			ys[i] = (*centers)[i].y;
+		}
+
+		const PixelKernels *k = kernels();
+		for( int i = 0; i < n; i++ )
+			k->distanceRow( &xs[0], &ys[0], xs[i], ys[i], &d[ (size_t)i * n ], n );
+	}
+
+	int size() const { return n; }
+	float at( int i, int j ) const { return d[ (size_t)i * n + j ]; }
+	const float* row( int i ) const { return &d[ (size_t)i * n ]; }
+
+private:
+	int n;
+	std::vector<float> xs, ys;
+	std::vector<float> d;           // Row major, symmetric, zero diagonal
+};
+
+#endif
@@ -0,0 +1,96 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// AOSS Vision Module - Marco Lancini (www.marcolancini.it)
+//
+//
+// Copyright (C) 2012 Marco Lancini
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef AOSS_OUTLINES_HPP
+#define AOSS_OUTLINES_HPP
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// OUTLINE ARENA ///////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// The points of one outline, inside an OutlineArena
+struct PointSpan
+{
+	const cv::Point *points;
+	int count;
+
+	bool empty() const { return count == 0; }
+
+	// A header over the points, for the OpenCV functions taking a curve
+	cv::Mat mat() const { return cv::Mat( count, 1, CV_32SC2, (void*)points ); }
+};
+
+// Many outlines stored one after the other in a single point array, with the
+// offset where each one starts (the compressed sparse row layout). clear()
+// keeps the memory, so once the arena has grown to the size of a busy frame
+// adding outlines allocates nothing. Spans are valid until the next change.
+class OutlineArena
+{
+public:
+	OutlineArena() : offsets( 1, 0 ) {}
+
+	void clear()
+	{
+		points.clear();
+		offsets.resize( 1 );
+	}
+
+	int size() const { return (int)offsets.size() - 1; }
+	bool empty() const { return size() == 0; }
+
+	PointSpan operator[]( int i ) const
+	{
+		PointSpan s;
+		s.count  = offsets[i + 1] - offsets[i];
+		s.points = s.count ? &points[ offsets[i] ] : NULL;
+		return s;
+	}
+
+	// Adds an outline, moved by shift
+	void append( const cv::Point *p, int n, cv::Point shift = cv::Point() )
+	{
+		for( int i = 0; i < n; i++ ) points.push_back( p[i] + shift );
+		offsets.push_back( (int)points.size() );
+	}
+
+	void append( PointSpan s, cv::Point shift = cv::Point() ) { append( s.points, s.count, shift ); }
+
+	// The layout itself, for the kernels: x, y pairs, and size() + 1 offsets
+	const int* xy() const { return points.empty() ? NULL : &points[0].x; }
+	const int* starts() const { return &offsets[0]; }
+
+private:
+	std::vector<cv::Point> points;
+	std::vector<int> offsets;       // Outline i is points[ offsets[i] .. offsets[i+1] )
+};
+
+#endif
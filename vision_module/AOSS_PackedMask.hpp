@@ -0,0 +1,258 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// AOSS Vision Module - Marco Lancini (www.marcolancini.it)
+//
+//
+// Copyright (C) 2012 Marco Lancini
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef AOSS_PACKED_MASK_HPP
+#define AOSS_PACKED_MASK_HPP
+
+#include <vector>
+#include <stdint.h>
+
+#include <opencv2/core/core.hpp>
+
+#include "AOSS_Blobs.hpp"
+#include "AOSS_Kernels.hpp"
+#include "AOSS_Scanline.hpp"
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// PACKED MASK /////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Binary image stored at 1 bit per pixel.
+// Bit j of word w in a row is the pixel at column w*64 + j; the padding bits
+// past the last column are always kept at zero.
+struct PackedMask
+{
+	int rows;
+	int cols;
+	int words;                      // 64-bit words per row
+	std::vector<uint64_t> bits;
+
+	PackedMask() : rows(0), cols(0), words(0) {}
+
+	void create( int r, int c )
+	{
+		rows  = r;
+		cols  = c;
+		words = ( c + 63 ) / 64;
+		bits.resize( (size_t)rows * words );
+	}
+
+	uint64_t*       row( int y )       { return &bits[ (size_t)y * words ]; }
+	const uint64_t* row( int y ) const { return &bits[ (size_t)y * words ]; }
+
+	// Valid bits of the last word of each row
+	uint64_t tailMask() const { return ( cols % 64 ) ? ( ( (uint64_t)1 << ( cols % 64 ) ) - 1 ) : ~(uint64_t)0; }
+};
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// PACK / UNPACK ///////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+inline void packThresholdInv( cv::Mat *gray, PackedMask *dst, int thresh )
+{
+	// Same as threshold( THRESH_BINARY_INV ): a bit is set where gray <= thresh
+
+	dst->create( gray->rows, gray->cols );
+	const PixelKernels *k = kernels();
+
+	for( int y = 0; y < gray->rows; y++ )
+		k->thresholdBits( gray->ptr<uchar>(y), dst->row(y), gray->cols, thresh );
+}
+
+inline void packedSkinFilter( const cv::Mat *frame, const PackedMask *dark, PackedMask *dst,
+							  const HsvTables *hsv, int maxH, int maxS, int maxV )
+{
+	// Packed equivalent of skinPixels() followed by the subtraction: a dark
+	// bit survives only where H <= maxH, S <= maxS and V <= maxV. Only the set
+	// bits are converted to HSV, and empty words are skipped whole
+
+	dst->create( dark->rows, dark->cols );
+
+	for( int y = 0; y < dark->rows; y++ )
+	{
+		const uchar *bgr   = frame->ptr<uchar>(y);
+		const uint64_t *in = dark->row(y);
+		uint64_t *out      = dst->row(y);
+
+		for( int w = 0; w < dark->words; w++ )
+		{
+			uint64_t keep = in[w];
+			for( uint64_t b = keep; b; b &= b - 1 )
+			{
+				int x = w * 64 + __builtin_ctzll( b );
+				int h, s, v;
+				hsv->convert( bgr + 3*x, &h, &s, &v );
+				if( h > maxH || s > maxS || v > maxV ) keep &= ~( (uint64_t)1 << ( x & 63 ) );
+			}
+			out[w] = keep;
+		}
+	}
+}
+
+inline void unpackMask( const PackedMask *src, cv::Mat *dst )
+{
+	// Expands to a CV_8UC1 image holding 0 / 255, as produced by threshold()
+
+	dst->create( src->rows, src->cols, CV_8UC1 );
+
+	for( int y = 0; y < src->rows; y++ )
+	{
+		const uint64_t *in = src->row(y);
+		uchar *out = dst->ptr<uchar>(y);
+
+		for( int x = 0; x < src->cols; x++ )
+			out[x] = ( in[x >> 6] >> ( x & 63 ) ) & 1 ? 255 : 0;
+	}
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// LOGIC ///////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+inline void packedAndNot( const PackedMask *a, const PackedMask *b, PackedMask *dst )
+{
+	// dst = a AND NOT b, the binary equivalent of subtract( a, b )
+
+	dst->create( a->rows, a->cols );
+	if( !a->bits.empty() ) kernels()->andNotWords( &a->bits[0], &b->bits[0], &dst->bits[0], a->bits.size() );
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// MORPHOLOGY //////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+inline void packedMorph( const PackedMask *src, PackedMask *dst, int radius, bool erode )
+{
+	// Rectangular (2*radius+1)^2 erosion or dilation, done as a horizontal pass
+	// of word shifts followed by a vertical pass over whole rows, both with
+	// the kernels of kernels(). As in OpenCV, pixels outside the image never
+	// erode and never dilate. radius must be < 64
+
+	const PixelKernels *k = kernels();
+	int rows  = src->rows;
+	int words = src->words;
+	uint64_t fill = erode ? ~(uint64_t)0 : 0;
+	uint64_t tail = src->tailMask();
+
+	PackedMask tmp;
+	tmp.create( rows, src->cols );
+	std::vector<uint64_t> line( words + 2, fill );      // A fill word on each side
+
+	// Horizontal pass
+	for( int y = 0; y < rows; y++ )
+	{
+		std::copy( src->row(y), src->row(y) + words, line.begin() + 1 );
+		if( erode ) line[words] |= ~tail;           // Columns past the border count as set
+
+		uint64_t *out = tmp.row(y);
+		if( erode ) k->erodeWordsH( &line[0], out, words, radius );
+		else        k->dilateWordsH( &line[0], out, words, radius );
+		out[words - 1] &= tail;
+	}
+
+	// Vertical pass
+	dst->create( rows, src->cols );
+	for( int y = 0; y < rows; y++ )
+	{
+		int y0 = std::max( 0, y - radius );
+		int y1 = std::min( rows - 1, y + radius );
+		uint64_t *out = dst->row(y);
+
+		std::copy( tmp.row(y0), tmp.row(y0) + words, out );
+		for( int yy = y0 + 1; yy <= y1; yy++ )
+		{
+			const uchar *in = (const uchar*)tmp.row(yy);
+			if( erode ) k->andRow( (uchar*)out, in, words * 8 );
+			else        k->orRow( (uchar*)out, in, words * 8 );
+		}
+	}
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// LABELING ////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+inline void packedRuns( const PackedMask *src, std::vector<Run> *runs )
+{
+	// Extracts the runs of set bits a word at a time, skipping empty words
+
+	runs->clear();
+
+	for( int y = 0; y < src->rows; y++ )
+	{
+		const uint64_t *in = src->row(y);
+		int start = -1;                         // Start of a run still open at the end of the previous word
+
+		for( int w = 0; w < src->words; w++ )
+		{
+			uint64_t b = in[w];
+			int base = w * 64;
+			int pos  = 0;
+
+			if( start < 0 && b == 0 ) continue;
+
+			while( pos < 64 )
+			{
+				if( start < 0 )
+				{
+					uint64_t ones = b >> pos;
+					if( ones == 0 ) break;
+					pos  += __builtin_ctzll( ones );
+					start = base + pos;
+				}
+
+				uint64_t zeros = ~b >> pos;
+				if( zeros == 0 ) break;             // Run continues into the next word
+				pos += __builtin_ctzll( zeros );
+
+				Run r = { y, start, base + pos };
+				runs->push_back( r );
+				start = -1;
+			}
+		}
+
+		if( start >= 0 )
+		{
+			Run r = { y, start, src->cols };
+			runs->push_back( r );
+		}
+	}
+}
+
+inline void labelPackedMask( const PackedMask *src, std::vector<Blob> *blobs, std::vector<Run> *runs, std::vector<int> *labels )
+{
+	// Connected components of a packed mask, without unpacking it
+	packedRuns( src, runs );
+	labelRuns( runs, blobs, labels );
+}
+
+#endif
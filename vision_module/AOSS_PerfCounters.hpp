@@ -0,0 +1,267 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// AOSS Vision Module - Marco Lancini (www.marcolancini.it)
+//
+//
+// Copyright (C) 2012 Marco Lancini
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef AOSS_PERF_COUNTERS_HPP
+#define AOSS_PERF_COUNTERS_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cstring>
+#include <cerrno>
+#include <stdint.h>
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// HARDWARE COUNTERS ///////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Cycles, instructions, L1 data and last level cache misses and branch misses
+// of the calling thread, from perf_event_open (Linux only). The counters are
+// opened as one group and read with a single call. When the kernel refuses
+// the group (no PMU in a container or VM, perf_event_paranoid too high) the
+// object stays unavailable and says why; a counter refused on its own is
+// just missing from the readings.
+class PerfCounters
+{
+public:
+	enum { CYCLES, INSTRUCTIONS, L1D_MISSES, LLC_MISSES, BRANCH_MISSES, COUNT };
+
+	// Counts since open, scaled up if the kernel had to share the hardware
+	// with other groups; a counter that is not open reads as -1
+	struct Reading
+	{
+		double value[COUNT];
+	};
+
+	PerfCounters() : leader(-1)
+	{
+		for( int i = 0; i < COUNT; i++ )
+		{
+			fd[i]   = -1;
+			slot[i] = -1;
+		}
+	}
+
+	~PerfCounters() { close(); }
+
+	bool open()
+	{
+#if defined(__linux__)
+		static const uint32_t types[COUNT]   = { PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+												 PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE };
+		static const uint64_t configs[COUNT] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+												 PERF_COUNT_HW_CACHE_L1D | ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) | ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 ),
+												 PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+		int members = 0;
+		for( int i = 0; i < COUNT; i++ )
+		{
+			perf_event_attr attr;
+			memset( &attr, 0, sizeof(attr) );
+			attr.size           = sizeof(attr);
+			attr.type           = types[i];
+			attr.config         = configs[i];
+			attr.disabled       = ( i == 0 );
+			attr.exclude_kernel = 1;
+			attr.exclude_hv     = 1;
+			attr.read_format    = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+			fd[i] = (int)syscall( __NR_perf_event_open, &attr, 0, -1, leader, 0 );
+			if( fd[i] < 0 )
+			{
+				if( i == 0 )
+				{
+					problem = std::string( "perf_event_open: " ) + strerror( errno );
+					if( errno == EACCES || errno == EPERM ) problem += ", see /proc/sys/kernel/perf_event_paranoid";
+					if( errno == ENOENT || errno == ENODEV || errno == EOPNOTSUPP ) problem += ", no hardware counters here";
+					return false;
+				}
+				continue;
+			}
+			if( i == 0 ) leader = fd[0];
+			slot[i] = members++;
+		}
+
+		ioctl( leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP );
+		ioctl( leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP );
+		return true;
+#else
+		problem = "hardware counters are only read on Linux";
+		return false;
+#endif
+	}
+
+	bool available() const { return leader >= 0; }
+	bool has( int counter ) const { return slot[counter] >= 0; }
+	const std::string& why() const { return problem; }
+
+	bool read( Reading *r )
+	{
+#if defined(__linux__)
+		// nr, time enabled, time running, then one value per member
+		uint64_t data[3 + COUNT];
+		if( leader < 0 || ::read( leader, data, sizeof(data) ) < (ssize_t)( 3 * sizeof(uint64_t) ) ) return false;
+
+		double scale = data[2] ? (double)data[1] / data[2] : 0;
+		for( int i = 0; i < COUNT; i++ )
+			r->value[i] = ( slot[i] >= 0 && slot[i] < (int)data[0] ) ? data[3 + slot[i]] * scale : -1;
+		return true;
+#else
+		(void)r;
+		return false;
+#endif
+	}
+
+	void close()
+	{
+#if defined(__linux__)
+		for( int i = COUNT - 1; i >= 0; i-- )
+			if( fd[i] >= 0 ) ::close( fd[i] );
+#endif
+		for( int i = 0; i < COUNT; i++ )
+		{
+			fd[i]   = -1;
+			slot[i] = -1;
+		}
+		leader = -1;
+	}
+
+private:
+	int fd[COUNT];
+	int slot[COUNT];                // Position in the group reading, -1 if not open
+	int leader;
+	std::string problem;
+
+	PerfCounters( const PerfCounters& );
+	PerfCounters& operator=( const PerfCounters& );
+};
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// STAGE PROFILE ///////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Counters added up per named stage: begin() before the stage, end() after
+// it with the pixels it worked on. Does nothing until start() succeeds.
+class StageProfile
+{
+public:
+	StageProfile() : enabled(false) {}
+
+	// Returns false, and the profile stays off, if the counters cannot be read
+	bool start()
+	{
+		enabled = counters.open() && counters.read( &last );
+		return enabled;
+	}
+
+	bool active() const { return enabled; }
+	const std::string& why() const { return counters.why(); }
+
+	void begin()
+	{
+		if( enabled ) counters.read( &last );
+	}
+
+	void end( const std::string &stage, double pixels )
+	{
+		if( !enabled ) return;
+
+		PerfCounters::Reading now;
+		if( !counters.read( &now ) ) return;
+
+		Totals &t = totals[stage];
+		if( t.runs == 0 ) order.push_back( stage );
+		t.runs++;
+		t.pixels += pixels;
+		for( int i = 0; i < PerfCounters::COUNT; i++ ) t.value[i] += now.value[i] - last.value[i];
+		last = now;
+	}
+
+	// Per stage: cycles per run, instructions per cycle, and misses per pixel
+	void report( std::ostream &out ) const
+	{
+		if( !enabled ) return;
+
+		const char *misses[] = { "L1D miss/px", "LLC miss/px", "br miss/px" };
+		out << "Hardware counters, analysis thread only" << std::endl
+			<< std::setw(14) << "stage" << std::setw(8) << "runs" << std::setw(14) << "Mcycles/run" << std::setw(8) << "IPC";
+		for( int m = 0; m < 3; m++ ) out << std::setw(14) << misses[m];
+		out << std::endl;
+
+		for( size_t s = 0; s < order.size(); s++ )
+		{
+			const Totals &t = totals.at( order[s] );
+			out << std::setw(14) << order[s] << std::setw(8) << t.runs
+				<< std::setw(14) << cell( PerfCounters::CYCLES, t.value[PerfCounters::CYCLES] / 1e6 / t.runs, 3 )
+				<< std::setw(8)  << cell( PerfCounters::INSTRUCTIONS, t.value[PerfCounters::CYCLES] > 0 ? t.value[PerfCounters::INSTRUCTIONS] / t.value[PerfCounters::CYCLES] : 0, 2 );
+			for( int m = 0; m < 3; m++ )
+			{
+				int c = PerfCounters::L1D_MISSES + m;
+				out << std::setw(14) << cell( c, t.pixels > 0 ? t.value[c] / t.pixels : 0, 4 );
+			}
+			out << std::endl;
+		}
+	}
+
+private:
+	struct Totals
+	{
+		long runs;
+		double pixels;
+		double value[PerfCounters::COUNT];
+
+		Totals() : runs(0), pixels(0) { for( int i = 0; i < PerfCounters::COUNT; i++ ) value[i] = 0; }
+	};
+
+	PerfCounters counters;
+	bool enabled;
+	PerfCounters::Reading last;
+	std::map<std::string, Totals> totals;
+	std::vector<std::string> order;
+
+	std::string cell( int counter, double v, int digits ) const
+	{
+		if( !counters.has( counter ) ) return "n/a";
+		std::ostringstream s;
+		s << std::fixed << std::setprecision( digits ) << v;
+		return s.str();
+	}
+};
+
+#endif
@@ -0,0 +1,225 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// AOSS Vision Module - Marco Lancini (www.marcolancini.it)
+//
+//
+// Copyright (C) 2012 Marco Lancini
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef AOSS_PROFILES_HPP
+#define AOSS_PROFILES_HPP
+
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+
+#include <opencv2/core/core.hpp>
+
+#include "AOSS_Blobs.hpp"
+#include "AOSS_Kernels.hpp"
+#include "AOSS_Scanline.hpp"
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// PROFILE PEAKS ///////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+struct ProfilePeak
+{
+	int lo, hi;                     // First and last line, inclusive
+	double mass;                    // Set pixels of the lines
+	double moment;                  // Sum of line index times its pixels
+};
+
+inline bool heavierPeak( const ProfilePeak &a, const ProfilePeak &b ) { return a.mass > b.mass; }
+
+inline void profilePeaks( const int *profile, int n, int minCount, int maxGap, std::vector<ProfilePeak> *peaks )
+{
+	// Stretches of lines holding more than minCount pixels, bridging up to
+	// maxGap quieter lines, heaviest first
+
+	peaks->clear();
+	int last = -1;                  // Last line above minCount in the open peak
+
+	for( int i = 0; i < n; i++ )
+	{
+		if( profile[i] <= minCount ) continue;
+
+		int from = last + 1;        // The quiet lines bridged count too
+		if( last < 0 || i - last - 1 > maxGap )
+		{
+			ProfilePeak p = { i, i, 0, 0 };
+			peaks->push_back( p );
+			from = i;
+		}
+
+		ProfilePeak &p = peaks->back();
+		for( int j = from; j <= i; j++ )
+		{
+			p.mass   += profile[j];
+			p.moment += (double)j * profile[j];
+		}
+		p.hi = last = i;
+	}
+
+	std::sort( peaks->begin(), peaks->end(), heavierPeak );
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// PROFILE DETECTOR ////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Finds two objects from the row and column sums of the dark-object mask,
+// without contours, polygons or moments. The mask (gray, threshold, skin
+// filter, no blur and no morphology) and both profiles come out of a single
+// pass over the frame. The objects must be apart along one axis: each of the
+// two heaviest peaks of that profile gives a band, whose own profile across
+// gives the other coordinate. Anything else (one peak, a third object close in
+// mass, two objects in the same band) is reported as ambiguous, and the
+// caller runs the full detector. Frames up to 65535 rows.
+class ProfileDetector
+{
+public:
+	int thresh;                     // Dark threshold (inverted binary)
+	int maxH, maxS, maxV;           // Skin limits, see skinPixels()
+	int minCount;                   // Lines with this many pixels or less are noise
+	int maxGap;                     // Quiet lines bridged inside a peak
+	double minArea;                 // Smallest object, as thresh_area
+	double maxRatio;                // A runner-up peak heavier than this fraction is ambiguous
+
+	int frames, fallbacks;          // Statistics
+
+	ProfileDetector( int thresh_, int erosion, double minArea_ )
+		: thresh(thresh_), maxH(18), maxS(50), maxV(80),
+		  minCount(2*erosion + 1), maxGap(2*erosion + 1), minArea(minArea_), maxRatio(0.25),
+		  frames(0), fallbacks(0) {}
+
+	// mask receives the dark-object mask; false means ambiguous, blobs empty
+	bool run( cv::Mat *frame, cv::Mat *mask, std::vector<Blob> *blobs )
+	{
+		frames++;
+		blobs->clear();
+
+		rows = frame->rows;
+		cols = frame->cols;
+		mask->create( rows, cols, CV_8UC1 );
+		const PixelKernels *k = kernels();
+
+		// Mask and both profiles, one pass /////////////////////////////////////
+		colSums.assign( cols, 0 );
+		rowProfile.resize( rows );
+		grayLine.resize( cols );
+		for( int y = 0; y < rows; y++ )
+		{
+			const uchar *bgr = frame->ptr<uchar>(y);
+			uchar *m = mask->ptr<uchar>(y);
+			k->grayRow( bgr, &grayLine[0], cols );
+			for( int x = 0; x < cols; x++ )
+			{
+				uchar v = 0;
+				if( grayLine[x] <= thresh )
+				{
+					int h, s, vv;
+					hsv.convert( bgr + 3*x, &h, &s, &vv );
+					v = ( h <= maxH && s <= maxS && vv <= maxV ) ? 255 : 0;
+				}
+				m[x] = v;
+			}
+			rowProfile[y] = k->profileRow( m, &colSums[0], cols );
+		}
+		colProfile.assign( colSums.begin(), colSums.end() );
+
+		// Apart along x, else along y /////////////////////////////////////////
+		if( split( mask, true, blobs ) || split( mask, false, blobs ) ) return true;
+
+		blobs->clear();
+		fallbacks++;
+		return false;
+	}
+
+private:
+	int rows, cols;
+	HsvTables hsv;
+	std::vector<uchar> grayLine;
+	std::vector<uint16_t> colSums, bandSums;
+	std::vector<int> rowProfile, colProfile, crossProfile;
+	std::vector<ProfilePeak> peaks, crossPeaks;
+
+	bool dominantPair( const std::vector<ProfilePeak> &p ) const
+	{
+		return p.size() >= 2 && p[1].mass > minArea && ( p.size() == 2 || p[2].mass <= maxRatio * p[1].mass );
+	}
+
+	bool split( cv::Mat *mask, bool alongX, std::vector<Blob> *blobs )
+	{
+		blobs->clear();
+
+		const std::vector<int> &along = alongX ? colProfile : rowProfile;
+		profilePeaks( &along[0], (int)along.size(), minCount, maxGap, &peaks );
+		if( !dominantPair( peaks ) ) return false;
+
+		const PixelKernels *k = kernels();
+		for( int i = 0; i < 2; i++ )
+		{
+			const ProfilePeak &band = peaks[i];
+
+			// Profile across the band, from the mask rows it covers
+			if( alongX )
+			{
+				crossProfile.resize( rows );
+				bandSums.resize( band.hi - band.lo + 1 );
+				for( int y = 0; y < rows; y++ )
+					crossProfile[y] = k->profileRow( mask->ptr<uchar>(y) + band.lo, &bandSums[0], band.hi - band.lo + 1 );
+			}
+			else
+			{
+				bandSums.assign( cols, 0 );
+				for( int y = band.lo; y <= band.hi; y++ ) k->profileRow( mask->ptr<uchar>(y), &bandSums[0], cols );
+				crossProfile.assign( bandSums.begin(), bandSums.end() );
+			}
+
+			// One object per band
+			profilePeaks( &crossProfile[0], (int)crossProfile.size(), minCount, maxGap, &crossPeaks );
+			if( crossPeaks.empty() || crossPeaks[0].mass <= minArea ) return false;
+			if( crossPeaks.size() > 1 && crossPeaks[1].mass > maxRatio * crossPeaks[0].mass ) return false;
+
+			// Centroid from the mass of each profile around its peak
+			const ProfilePeak &cross = crossPeaks[0];
+			const ProfilePeak &px = alongX ? band : cross;
+			const ProfilePeak &py = alongX ? cross : band;
+
+			Blob b;
+			b.m00  = cross.mass;
+			b.m10  = b.m00 * px.moment / px.mass;
+			b.m01  = b.m00 * py.moment / py.mass;
+			b.minx = px.lo;
+			b.maxx = px.hi;
+			b.miny = py.lo;
+			b.maxy = py.hi;
+			blobs->push_back( b );
+		}
+		return true;
+	}
+};
+
+#endif
@@ -0,0 +1,229 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// AOSS Vision Module - Marco Lancini (www.marcolancini.it)
+//
+//
+// Copyright (C) 2012 Marco Lancini
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef AOSS_RESULTS_SINK_HPP
+#define AOSS_RESULTS_SINK_HPP
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// RECORD //////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+enum ResultFlags
+{
+	RESULT_FOUND     = 1,           // Both objects were found
+	RESULT_DISPLAYED = 2,           // The frame was drawn in the windows
+	RESULT_GAP       = 4,           // Records before this one were dropped
+	RESULT_TRACKED   = 8            // Positions from optical flow, not from the detector
+};
+
+// Outcome of one frame, 48 bytes with no padding; the binary encoder writes
+// it as is, in native byte order
+struct ResultRecord
+{
+	int32_t  frame;
+	uint32_t flags;
+	double   timestamp;             // Seconds from the start of the video
+	float    x1, y1;                // Center of the biggest object
+	float    x2, y2;                // Center of the second one
+	int32_t  dx, dy;
+	float    distance;
+	uint32_t reserved;
+};
+
+static_assert( sizeof(ResultRecord) == 48, "ResultRecord must stay 48 bytes" );
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// ENCODERS ////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+class ResultEncoder
+{
+public:
+	virtual ~ResultEncoder() {}
+	virtual void header( std::string * ) {}
+	virtual void encode( const ResultRecord *r, int n, std::string *out ) = 0;
+};
+
+class BinaryEncoder : public ResultEncoder
+{
+public:
+	void encode( const ResultRecord *r, int n, std::string *out )
+	{
+		out->append( (const char*)r, n * sizeof(ResultRecord) );
+	}
+};
+
+class CsvEncoder : public ResultEncoder
+{
+public:
+	void header( std::string *out )
+	{
+		out->append( "frame,timestamp,x1,y1,x2,y2,dx,dy,distance,flags\n" );
+	}
+
+	void encode( const ResultRecord *r, int n, std::string *out )
+	{
+		char line[160];
+		for( int i = 0; i < n; i++ )
+		{
+			int len = snprintf( line, sizeof(line), "%d,%.3f,%.1f,%.1f,%.1f,%.1f,%d,%d,%.2f,%u\n",
+								r[i].frame, r[i].timestamp, r[i].x1, r[i].y1, r[i].x2, r[i].y2,
+								r[i].dx, r[i].dy, r[i].distance, r[i].flags );
+			out->append( line, len );
+		}
+	}
+};
+
+class JsonLinesEncoder : public ResultEncoder
+{
+public:
+	void encode( const ResultRecord *r, int n, std::string *out )
+	{
+		char line[256];
+		for( int i = 0; i < n; i++ )
+		{
+			int len = snprintf( line, sizeof(line),
+								"{\"frame\":%d,\"timestamp\":%.3f,\"p1\":[%.1f,%.1f],\"p2\":[%.1f,%.1f],"
+								"\"dx\":%d,\"dy\":%d,\"distance\":%.2f,\"flags\":%u}\n",
+								r[i].frame, r[i].timestamp, r[i].x1, r[i].y1, r[i].x2, r[i].y2,
+								r[i].dx, r[i].dy, r[i].distance, r[i].flags );
+			out->append( line, len );
+		}
+	}
+};
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// RESULTS SINK ////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Single-producer ring of records drained by a writer thread, which encodes
+// whole batches and writes them with one fwrite. push() never blocks and
+// never makes a system call: if the ring is full the record is dropped and
+// the next one that fits carries RESULT_GAP.
+class ResultsSink
+{
+public:
+	// The sink owns the encoder; out is flushed, not closed, by the destructor
+	ResultsSink( FILE *out_, ResultEncoder *encoder_, int capacity = 4096 )
+		: out(out_), encoder(encoder_), ring( capacity ), head(0), tail(0), running(true), dropped(0), gap(false)
+	{
+		std::string text;
+		encoder->header( &text );
+		if( !text.empty() ) fwrite( text.data(), 1, text.size(), out );
+		writer = std::thread( &ResultsSink::loop, this );
+	}
+
+	~ResultsSink()
+	{
+		running = false;
+		writer.join();
+		drain();
+		fflush( out );
+		delete encoder;
+	}
+
+	// Analysis thread
+	void push( const ResultRecord &record )
+	{
+		size_t h = head.load( std::memory_order_relaxed );
+		if( h - tail.load( std::memory_order_acquire ) == ring.size() )
+		{
+			dropped++;
+			gap = true;
+			return;
+		}
+
+		ResultRecord &slot = ring[ h % ring.size() ];
+		slot = record;
+		if( gap ) slot.flags |= RESULT_GAP;
+		gap = false;
+		head.store( h + 1, std::memory_order_release );
+	}
+
+	long long droppedRecords() const { return dropped; }
+
+private:
+	FILE *out;
+	ResultEncoder *encoder;
+	std::vector<ResultRecord> ring;
+	std::atomic<size_t> head;       // Next record to write, owned by push()
+	std::atomic<size_t> tail;       // Next record to encode, owned by the writer
+	std::atomic<bool> running;
+	std::thread writer;
+	std::string text;               // Encoded batch, reused
+
+	long long dropped;              // Owned by push()
+	bool gap;
+
+	void loop()
+	{
+		// Batches build up between wakeups; the producer never signals
+		while( running )
+		{
+			if( !drain() ) std::this_thread::sleep_for( std::chrono::milliseconds(2) );
+		}
+	}
+
+	bool drain()
+	{
+		size_t t = tail.load( std::memory_order_relaxed );
+		size_t h = head.load( std::memory_order_acquire );
+		if( t == h ) return false;
+
+		text.clear();
+		while( t != h )
+		{
+			// Contiguous part of the ring up to the wrap point
+			size_t start = t % ring.size();
+			size_t n = std::min( h - t, ring.size() - start );
+			encoder->encode( &ring[start], (int)n, &text );
+			t += n;
+		}
+		tail.store( t, std::memory_order_release );
+
+		fwrite( text.data(), 1, text.size(), out );
+		fflush( out );
+		return true;
+	}
+
+	ResultsSink( const ResultsSink& );
+	ResultsSink& operator=( const ResultsSink& );
+};
+
+#endif
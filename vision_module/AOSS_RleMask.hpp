@@ -0,0 +1,281 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// AOSS Vision Module - Marco Lancini (www.marcolancini.it)
+//
+//
+// Copyright (C) 2012 Marco Lancini
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef AOSS_RLE_MASK_HPP
+#define AOSS_RLE_MASK_HPP
+
+#include <vector>
+#include <algorithm>
+
+#include <opencv2/core/core.hpp>
+
+#include "AOSS_Blobs.hpp"
+#include "AOSS_Scanline.hpp"
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// RLE MASK ////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Binary image stored as runs of set pixels.
+// Runs are sorted by row and then by x, never overlap or touch, and the runs
+// of row y are runs[ rowStart[y] ] .. runs[ rowStart[y+1] - 1 ].
+struct RleMask
+{
+	int rows;
+	int cols;
+	std::vector<Run> runs;
+	std::vector<int> rowStart;
+
+	RleMask() : rows(0), cols(0) {}
+
+	void reset( int r, int c )
+	{
+		rows = r;
+		cols = c;
+		runs.clear();
+		rowStart.assign( 1, 0 );
+	}
+
+	// Closes the current row; rows must be filled in order
+	void endRow() { rowStart.push_back( runs.size() ); }
+
+	const Run* rowBegin( int y ) const { return runs.empty() ? 0 : &runs[0] + rowStart[y]; }
+	int        rowCount( int y ) const { return rowStart[y + 1] - rowStart[y]; }
+};
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// THRESHOLD ///////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+inline void rleThresholdInv( cv::Mat *gray, RleMask *dst, int thresh )
+{
+	// Same as threshold( THRESH_BINARY_INV ), emitting runs instead of pixels
+
+	dst->reset( gray->rows, gray->cols );
+
+	for( int y = 0; y < gray->rows; y++ )
+	{
+		const uchar *src = gray->ptr<uchar>(y);
+		int x = 0;
+		while( x < gray->cols )
+		{
+			while( x < gray->cols && src[x] > thresh ) x++;
+			if( x == gray->cols ) break;
+
+			Run r = { y, x, 0 };
+			while( x < gray->cols && src[x] <= thresh ) x++;
+			r.x1 = x;
+			dst->runs.push_back( r );
+		}
+		dst->endRow();
+	}
+}
+
+inline void rleSubtractSkin( const RleMask *src, const cv::Mat *frame, const HsvTables *hsv, RleMask *dst, int maxH, int maxS, int maxV )
+{
+	// subtract( mask, imgSkin ) restricted to the pixels of the runs: a pixel
+	// survives only where H <= maxH, S <= maxS and V <= maxV (see skinPixels).
+	// Only those pixels are converted to HSV, straight from the BGR frame
+
+	dst->reset( src->rows, src->cols );
+
+	for( int y = 0; y < src->rows; y++ )
+	{
+		const uchar *bgr = frame->ptr<uchar>(y);
+		const Run *r = src->rowBegin(y);
+
+		for( int i = 0; i < src->rowCount(y); i++ )
+		{
+			int start = -1;             // Start of the open output run
+			for( int x = r[i].x0; x < r[i].x1; x++ )
+			{
+				int h, s, v;
+				hsv->convert( bgr + 3*x, &h, &s, &v );
+				bool keep = h <= maxH && s <= maxS && v <= maxV;
+
+				if( keep && start < 0 ) start = x;
+				if( !keep && start >= 0 )
+				{
+					Run out = { y, start, x };
+					dst->runs.push_back( out );
+					start = -1;
+				}
+			}
+			if( start >= 0 )
+			{
+				Run out = { y, start, r[i].x1 };
+				dst->runs.push_back( out );
+			}
+		}
+		dst->endRow();
+	}
+}
+
+inline void rleToMat( const RleMask *src, cv::Mat *dst )
+{
+	// Expands to a CV_8UC1 image holding 0 / 255
+
+	*dst = cv::Mat::zeros( src->rows, src->cols, CV_8UC1 );
+	for( size_t i = 0; i < src->runs.size(); i++ )
+	{
+		const Run &r = src->runs[i];
+		uchar *row = dst->ptr<uchar>( r.y );
+		std::fill( row + r.x0, row + r.x1, (uchar)255 );
+	}
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// ROW OPERATIONS //////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+inline void appendRun( std::vector<Run> *out, size_t rowBegin, int y, int x0, int x1 )
+{
+	// Appends [x0, x1) to the row being built, merging it with the last run if they touch
+	if( out->size() > rowBegin && out->back().x1 >= x0 )
+	{
+		if( x1 > out->back().x1 ) out->back().x1 = x1;
+		return;
+	}
+	Run r = { y, x0, x1 };
+	out->push_back( r );
+}
+
+inline void rowUnion( const Run *a, int na, const Run *b, int nb, int y, std::vector<Run> *out )
+{
+	size_t begin = out->size();
+	int i = 0, j = 0;
+	while( i < na || j < nb )
+	{
+		const Run &r = ( j >= nb || ( i < na && a[i].x0 <= b[j].x0 ) ) ? a[i++] : b[j++];
+		appendRun( out, begin, y, r.x0, r.x1 );
+	}
+}
+
+inline void rowIntersect( const Run *a, int na, const Run *b, int nb, int y, std::vector<Run> *out )
+{
+	int i = 0, j = 0;
+	while( i < na && j < nb )
+	{
+		int x0 = std::max( a[i].x0, b[j].x0 );
+		int x1 = std::min( a[i].x1, b[j].x1 );
+		if( x0 < x1 )
+		{
+			Run r = { y, x0, x1 };
+			out->push_back( r );
+		}
+		if( a[i].x1 < b[j].x1 ) i++;
+		else j++;
+	}
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// MORPHOLOGY //////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+inline void rleMorph( const RleMask *src, RleMask *dst, int radius, bool erode )
+{
+	// Rectangular (2*radius+1)^2 erosion or dilation on runs: runs are grown or
+	// shrunk horizontally, then the rows in the vertical window are united or
+	// intersected. As in OpenCV, pixels outside the image never erode and never
+	// dilate, so runs touching the border keep their border end
+
+	int rows = src->rows;
+	int cols = src->cols;
+
+	// Horizontal pass
+	RleMask tmp;
+	tmp.reset( rows, cols );
+	for( int y = 0; y < rows; y++ )
+	{
+		size_t begin = tmp.runs.size();
+		const Run *r = src->rowBegin(y);
+		for( int i = 0; i < src->rowCount(y); i++ )
+		{
+			if( erode )
+			{
+				int x0 = ( r[i].x0 == 0 )    ? 0    : r[i].x0 + radius;
+				int x1 = ( r[i].x1 == cols ) ? cols : r[i].x1 - radius;
+				if( x0 < x1 )
+				{
+					Run out = { y, x0, x1 };
+					tmp.runs.push_back( out );
+				}
+			}
+			else
+			{
+				appendRun( &tmp.runs, begin, y, std::max( 0, r[i].x0 - radius ), std::min( cols, r[i].x1 + radius ) );
+			}
+		}
+		tmp.endRow();
+	}
+
+	// Vertical pass
+	dst->reset( rows, cols );
+	std::vector<Run> acc, next;
+	for( int y = 0; y < rows; y++ )
+	{
+		int y0 = std::max( 0, y - radius );
+		int y1 = std::min( rows - 1, y + radius );
+
+		acc.assign( tmp.rowBegin(y0), tmp.rowBegin(y0) + tmp.rowCount(y0) );
+		for( int yy = y0 + 1; yy <= y1; yy++ )
+		{
+			if( erode && acc.empty() ) break;
+
+			next.clear();
+			const Run *accBegin = acc.empty() ? 0 : &acc[0];
+			if( erode ) rowIntersect( accBegin, acc.size(), tmp.rowBegin(yy), tmp.rowCount(yy), y, &next );
+			else        rowUnion( accBegin, acc.size(), tmp.rowBegin(yy), tmp.rowCount(yy), y, &next );
+			acc.swap( next );
+		}
+
+		for( size_t i = 0; i < acc.size(); i++ )
+		{
+			acc[i].y = y;
+			dst->runs.push_back( acc[i] );
+		}
+		dst->endRow();
+	}
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// LABELING ////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+inline void labelRleMask( const RleMask *src, std::vector<Blob> *blobs, std::vector<int> *labels )
+{
+	// Overlapping runs of adjacent rows are merged; moments and boxes are
+	// accumulated one run at a time
+	labelRuns( &src->runs, blobs, labels );
+}
+
+#endif
@@ -0,0 +1,269 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// AOSS Vision Module - Marco Lancini (www.marcolancini.it)
+//
+//
+// Copyright (C) 2012 Marco Lancini
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef AOSS_SCANLINE_HPP
+#define AOSS_SCANLINE_HPP
+
+#include <vector>
+#include <algorithm>
+
+#include <opencv2/core/core.hpp>
+
+#include "AOSS_Blobs.hpp"
+#include "AOSS_Kernels.hpp"
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// PIXEL HELPERS ///////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+inline int reflect101( int p, int n )
+{
+	// BORDER_REFLECT_101, the default border of blur()
+	if( n == 1 ) return 0;
+	while( p < 0 || p >= n ) p = ( p < 0 ) ? -p : 2*n - 2 - p;
+	return p;
+}
+
+inline void padReplicate( uchar *row, int cols, int pad )
+{
+	// Row stored at row[pad] .. row[pad+cols-1]; repeating the border pixel is
+	// the same as ignoring the outside for erosion and dilation
+	for( int k = 0; k < pad; k++ )
+	{
+		row[k] = row[pad];
+		row[pad + cols + k] = row[pad + cols - 1];
+	}
+}
+
+inline void padReflect( uchar *row, int cols )
+{
+	// Row stored at row[1] .. row[cols]; one pixel of BORDER_REFLECT_101 on
+	// each side, as blur() reads it
+	row[0]        = row[ cols > 1 ? 2 : 1 ];
+	row[cols + 1] = row[ cols > 1 ? cols - 1 : 1 ];
+}
+
+struct HsvTables
+{
+	// Fixed point CV_BGR2HSV for 8-bit images, as in cvtColor
+	int sdiv[256];
+	int hdiv[256];
+
+	HsvTables()
+	{
+		sdiv[0] = hdiv[0] = 0;
+		for( int i = 1; i < 256; i++ )
+		{
+			sdiv[i] = cvRound( ( 255 << 12 ) / (double)i );
+			hdiv[i] = cvRound( ( 180 << 12 ) / ( 6.0 * i ) );
+		}
+	}
+
+	void convert( const uchar *bgr, int *h, int *s, int *v ) const
+	{
+		int b = bgr[0], g = bgr[1], r = bgr[2];
+		int vmax = std::max( b, std::max( g, r ) );
+		int vmin = std::min( b, std::min( g, r ) );
+		int diff = vmax - vmin;
+		int vr = ( vmax == r ) ? -1 : 0;
+		int vg = ( vmax == g ) ? -1 : 0;
+
+		int hh = ( vr & ( g - b ) ) + ( ~vr & ( ( vg & ( b - r + 2*diff ) ) + ( ~vg & ( r - g + 4*diff ) ) ) );
+		hh = ( hh * hdiv[diff] + ( 1 << 11 ) ) >> 12;
+		if( hh < 0 ) hh += 180;
+
+		*h = hh;
+		*s = ( diff * sdiv[vmax] + ( 1 << 11 ) ) >> 12;
+		*v = vmax;
+	}
+};
+
+inline void sparseSkinFilter( const cv::Mat *frame, cv::Mat *mask, const HsvTables *hsv, int maxH, int maxS, int maxV )
+{
+	// subtract( mask, imgSkin ) in place on a 0 / 255 mask, without an HSV
+	// image: only the set pixels are converted, and the clear stretches
+	// between them are skipped by the nextSet kernel
+
+	const PixelKernels *k = kernels();
+	int cols = mask->cols;
+
+	for( int y = 0; y < mask->rows; y++ )
+	{
+		uchar *m = mask->ptr<uchar>(y);
+		const uchar *bgr = frame->ptr<uchar>(y);
+
+		for( int x = k->nextSet( m, 0, cols ); x < cols; x = k->nextSet( m, x + 1, cols ) )
+		{
+			int h, s, v;
+			hsv->convert( bgr + 3*x, &h, &s, &v );
+			if( h > maxH || s > maxS || v > maxV ) m[x] = 0;
+		}
+	}
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// SCANLINE PIPELINE ///////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Gray, blur, threshold, skin filter, erosion and dilation fused into one pass
+// over the frame. Each stage keeps only the rows its kernel needs in a small
+// ring buffer, and every finished row goes straight into the blob labeler:
+// only the final mask (and the skin filter view, when asked) is written out.
+class ScanlinePipeline
+{
+public:
+	int thresh;                     // Dark threshold (inverted binary)
+	int maxH, maxS, maxV;           // Skin limits, see skinPixels()
+	int erosion, dilation;          // Radii of the rectangular kernels
+
+	ScanlinePipeline( int thresh_, int erosion_, int dilation_ )
+		: thresh(thresh_), maxH(18), maxS(50), maxV(80), erosion(erosion_), dilation(dilation_), cols(0) {}
+
+	void run( cv::Mat *frame, cv::Mat *finalMask, cv::Mat *skinView, std::vector<Blob> *blobs )
+	{
+		// frame is 8-bit BGR; skinView may be NULL
+		scan( frame, finalMask, skinView );
+		finish( blobs );
+	}
+
+	// The two halves of run(): the pass over the rows, which labels the runs
+	// of each finished row, then the merge of the labels into blobs
+	void scan( cv::Mat *frame, cv::Mat *finalMask, cv::Mat *skinView )
+	{
+		rows = frame->rows;
+		if( frame->cols != cols ) allocate( frame->cols );
+
+		finalMask->create( rows, cols, CV_8UC1 );
+		if( skinView ) skinView->create( rows, cols, CV_8UC1 );
+		labeler.reset();
+
+		int latency = 1 + erosion + dilation;
+		for( int y = 0; y < rows + latency; y++ )
+		{
+			if( y < rows ) grayRow( frame, y );
+
+			int ym = y - 1;                 // Blur needs the gray row below
+			if( ym >= 0 && ym < rows ) maskRow( frame, skinView, ym );
+
+			int ye = ym - erosion;          // Erosion needs `erosion` mask rows below
+			if( ye >= 0 && ye < rows ) erodeRow( ye );
+
+			int yd = ye - dilation;         // Dilation needs `dilation` eroded rows below
+			if( yd >= 0 && yd < rows ) dilateRow( finalMask, yd );
+		}
+	}
+
+	void finish( std::vector<Blob> *blobs ) { labeler.finish( blobs ); }
+
+private:
+	int rows, cols;
+	HsvTables hsv;
+	RowLabeler labeler;
+
+	std::vector<uchar> grayRing;    // 3 gray rows of cols+2, reflected border
+	std::vector<uchar> dark;        // Blurred and thresholded row
+	std::vector<uchar> erodeRing;   // 2*erosion+1 mask rows, eroded horizontally
+	std::vector<uchar> dilateRing;  // 2*dilation+1 eroded rows, dilated horizontally
+	std::vector<uchar> maskLine;    // cols+2*erosion, replicated border
+	std::vector<uchar> erodedLine;  // cols+2*dilation, replicated border
+	const PixelKernels *k;
+
+	void allocate( int c )
+	{
+		cols = c;
+		grayRing.assign( 3 * ( cols + 2 ), 0 );
+		dark.assign( cols, 0 );
+		erodeRing.assign( ( 2*erosion + 1 ) * cols, 0 );
+		dilateRing.assign( ( 2*dilation + 1 ) * cols, 0 );
+		maskLine.assign( cols + 2*erosion, 0 );
+		erodedLine.assign( cols + 2*dilation, 0 );
+		k = kernels();
+	}
+
+	uchar* ring( std::vector<uchar> *buf, int y, int size ) { return &(*buf)[ ( y % size ) * cols ]; }
+	uchar* grayAt( int y ) { return &grayRing[ ( y % 3 ) * ( cols + 2 ) ]; }
+
+	void grayRow( cv::Mat *frame, int y )
+	{
+		uchar *dst = grayAt(y);
+		k->grayRow( frame->ptr<uchar>(y), dst + 1, cols );
+		padReflect( dst, cols );
+	}
+
+	void maskRow( cv::Mat *frame, cv::Mat *skinView, int y )
+	{
+		// 3x3 box blur, threshold, skin subtraction, then horizontal erosion
+		const uchar *bgr = frame->ptr<uchar>(y);
+		uchar *line = &maskLine[erosion];
+		k->blurThresholdRow( grayAt( reflect101( y - 1, rows ) ), grayAt(y), grayAt( reflect101( y + 1, rows ) ), &dark[0], cols, thresh );
+
+		// The skin test only matters where the pixel is dark
+		std::fill( line, line + cols, 0 );
+		for( int x = k->nextSet( &dark[0], 0, cols ); x < cols; x = k->nextSet( &dark[0], x + 1, cols ) )
+		{
+			int h, s, v;
+			hsv.convert( bgr + 3*x, &h, &s, &v );
+			line[x] = ( h <= maxH && s <= maxS && v <= maxV ) ? 255 : 0;
+		}
+
+		if( skinView ) std::copy( line, line + cols, skinView->ptr<uchar>(y) );
+
+		padReplicate( &maskLine[0], cols, erosion );
+		k->erodeRowH( &maskLine[0], ring( &erodeRing, y, 2*erosion + 1 ), cols, erosion );
+	}
+
+	void erodeRow( int y )
+	{
+		// Vertical erosion, then horizontal dilation
+		int y0 = std::max( 0, y - erosion ), y1 = std::min( rows - 1, y + erosion );
+		uchar *line = &erodedLine[dilation];
+
+		std::copy( ring( &erodeRing, y0, 2*erosion + 1 ), ring( &erodeRing, y0, 2*erosion + 1 ) + cols, line );
+		for( int yy = y0 + 1; yy <= y1; yy++ )
+			k->andRow( line, ring( &erodeRing, yy, 2*erosion + 1 ), cols );
+
+		padReplicate( &erodedLine[0], cols, dilation );
+		k->dilateRowH( &erodedLine[0], ring( &dilateRing, y, 2*dilation + 1 ), cols, dilation );
+	}
+
+	void dilateRow( cv::Mat *finalMask, int y )
+	{
+		// Vertical dilation into the final mask, then blob accumulation
+		int y0 = std::max( 0, y - dilation ), y1 = std::min( rows - 1, y + dilation );
+		uchar *dst = finalMask->ptr<uchar>(y);
+
+		std::copy( ring( &dilateRing, y0, 2*dilation + 1 ), ring( &dilateRing, y0, 2*dilation + 1 ) + cols, dst );
+		for( int yy = y0 + 1; yy <= y1; yy++ )
+			k->orRow( dst, ring( &dilateRing, yy, 2*dilation + 1 ), cols );
+
+		labeler.pushRow( y, dst, cols );
+	}
+};
+
+#endif
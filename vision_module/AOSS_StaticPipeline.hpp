@@ -0,0 +1,591 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// AOSS Vision Module - Marco Lancini (www.marcolancini.it)
+//
+//
+// Copyright (C) 2012 Marco Lancini
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef AOSS_STATIC_PIPELINE_HPP
+#define AOSS_STATIC_PIPELINE_HPP
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <algorithm>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "AOSS_Blobs.hpp"
+#include "AOSS_Scanline.hpp"
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// STAGE POLICIES //////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Inverted binary threshold: a blurred pixel is dark if <= Value
+template<int Value>
+struct ThresholdInv
+{
+	static_assert( Value >= 0 && Value < 255, "threshold out of range" );
+	static constexpr int value = Value;
+	static constexpr int limit = 9*Value + 4;   // Largest 3x3 sum that blurs to a dark pixel
+
+	static uchar apply( int v ) { return v <= Value ? 255 : 0; }
+};
+
+// Skin filter of skinPixels(): a dark pixel survives if H, S and V are all within the limits
+template<int MaxH, int MaxS, int MaxV>
+struct SkinLimits
+{
+	static constexpr int maxH = MaxH;
+	static constexpr int maxS = MaxS;
+	static constexpr int maxV = MaxV;
+
+	static uchar apply( const HsvTables &hsv, const uchar *bgr )
+	{
+		int h, s, v;
+		hsv.convert( bgr, &h, &s, &v );
+		return ( h <= MaxH && s <= MaxS && v <= MaxV ) ? 255 : 0;
+	}
+};
+
+// Rectangular erosion and dilation of size (2*Radius+1)^2
+template<int Radius>
+struct RectErode
+{
+	static_assert( Radius > 0 && Radius < 64, "kernel radius out of range" );
+	static constexpr int radius = Radius;
+	static constexpr bool erodes = true;
+
+	static uchar combine( uchar a, uchar b ) { return a & b; }
+};
+
+template<int Radius>
+struct RectDilate
+{
+	static_assert( Radius > 0 && Radius < 64, "kernel radius out of range" );
+	static constexpr int radius = Radius;
+	static constexpr bool erodes = false;
+
+	static uchar combine( uchar a, uchar b ) { return a | b; }
+};
+
+// Debug views: the GUI build writes the skin filter view, the headless build
+// compiles the same calls to nothing
+struct GuiViews
+{
+	static void prepare( cv::Mat *view, int rows, int cols ) { view->create( rows, cols, CV_8UC1 ); }
+	static void skinRow( cv::Mat *view, int y, const uchar *row, int cols ) { std::copy( row, row + cols, view->ptr<uchar>(y) ); }
+};
+
+struct HeadlessViews
+{
+	static void prepare( cv::Mat *, int, int ) {}
+	static void skinRow( cv::Mat *, int, const uchar *, int ) {}
+};
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// ROW KERNELS /////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+template<class Threshold>
+inline void blurThresholdRow( const uchar *g0, const uchar *g1, const uchar *g2, uchar *dark, int cols )
+{
+	// Rows padded by one pixel on each side
+	for( int x = 0; x < cols; x++ )
+	{
+		int sum = g0[x] + g0[x + 1] + g0[x + 2]
+				+ g1[x] + g1[x + 1] + g1[x + 2]
+				+ g2[x] + g2[x + 1] + g2[x + 2];
+		dark[x] = Threshold::apply( ( sum + 4 ) / 9 );
+	}
+}
+
+template<class Morph>
+inline void morphRowH( const uchar *padded, uchar *out, int cols )
+{
+	// Fixed trip count inner loop, unrolled by the compiler
+	for( int x = 0; x < cols; x++ )
+	{
+		uchar m = padded[x];
+		for( int k = 1; k <= 2 * Morph::radius; k++ ) m = Morph::combine( m, padded[x + k] );
+		out[x] = m;
+	}
+}
+
+template<class Morph>
+inline void morphRowV( const uchar *const *src, uchar *out, int cols )
+{
+	// src holds 2*radius+1 rows, border rows repeated
+	std::copy( src[0], src[0] + cols, out );
+	for( int k = 1; k <= 2 * Morph::radius; k++ )
+	{
+		const uchar *in = src[k];
+		for( int x = 0; x < cols; x++ ) out[x] = Morph::combine( out[x], in[x] );
+	}
+}
+
+template<class Morph>
+inline void morphTailV( const uchar *const *src, uchar *out, int x, int cols )
+{
+	// Columns x .. cols-1 of morphRowV, after a vector loop
+	for( ; x < cols; x++ )
+	{
+		uchar m = src[0][x];
+		for( int k = 1; k <= 2 * Morph::radius; k++ ) m = Morph::combine( m, src[k][x] );
+		out[x] = m;
+	}
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// INSTRUCTION SETS ////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Row bodies of each instruction set, templated on the stage policies so the
+// threshold and the radii are constants inside the vector loops. Gray
+// conversion and the search for dark pixels take no policy and call the
+// kernels of AOSS_Kernels.hpp directly
+struct StaticScalar
+{
+	static void grayRow( const uchar *bgr, uchar *gray, int cols ) { grayRowScalar( bgr, gray, cols ); }
+	static int nextSet( const uchar *row, int x, int cols ) { return nextSetScalar( row, x, cols ); }
+
+	template<class Threshold>
+	static void blurThreshold( const uchar *g0, const uchar *g1, const uchar *g2, uchar *dark, int cols ) { blurThresholdRow<Threshold>( g0, g1, g2, dark, cols ); }
+
+	template<class Morph>
+	static void morphH( const uchar *padded, uchar *out, int cols ) { morphRowH<Morph>( padded, out, cols ); }
+
+	template<class Morph>
+	static void morphV( const uchar *const *src, uchar *out, int cols ) { morphRowV<Morph>( src, out, cols ); }
+};
+
+#ifdef AOSS_HAVE_X86
+struct StaticSSE2
+{
+	static void grayRow( const uchar *bgr, uchar *gray, int cols ) { grayRowSSE2( bgr, gray, cols ); }
+	static int nextSet( const uchar *row, int x, int cols ) { return nextSetSSE2( row, x, cols ); }
+
+	template<class Morph> __attribute__((target("sse2")))
+	static __m128i combine( __m128i a, __m128i b ) { return Morph::erodes ? _mm_and_si128( a, b ) : _mm_or_si128( a, b ); }
+
+	template<class Threshold> __attribute__((target("sse2")))
+	static void blurThreshold( const uchar *g0, const uchar *g1, const uchar *g2, uchar *dark, int cols )
+	{
+		const __m128i limit = _mm_set1_epi16( (short)( Threshold::limit + 1 ) );
+		const __m128i z = _mm_setzero_si128();
+		const uchar *g[3] = { g0, g1, g2 };
+		int x = 0;
+		for( ; x + 16 <= cols; x += 16 )
+		{
+			__m128i lo = z, hi = z;
+			for( int r = 0; r < 3; r++ )
+				for( int k = 0; k < 3; k++ )
+				{
+					__m128i v = _mm_loadu_si128( (const __m128i*)( g[r] + x + k ) );
+					lo = _mm_add_epi16( lo, _mm_unpacklo_epi8( v, z ) );
+					hi = _mm_add_epi16( hi, _mm_unpackhi_epi8( v, z ) );
+				}
+			_mm_storeu_si128( (__m128i*)( dark + x ), _mm_packs_epi16( _mm_cmpgt_epi16( limit, lo ), _mm_cmpgt_epi16( limit, hi ) ) );
+		}
+		if( x < cols ) blurThresholdRow<Threshold>( g0 + x, g1 + x, g2 + x, dark + x, cols - x );
+	}
+
+	template<class Morph> __attribute__((target("sse2")))
+	static void morphH( const uchar *padded, uchar *out, int cols )
+	{
+		int x = 0;
+		for( ; x + 16 <= cols; x += 16 )
+		{
+			__m128i m = _mm_loadu_si128( (const __m128i*)( padded + x ) );
+			for( int k = 1; k <= 2 * Morph::radius; k++ ) m = combine<Morph>( m, _mm_loadu_si128( (const __m128i*)( padded + x + k ) ) );
+			_mm_storeu_si128( (__m128i*)( out + x ), m );
+		}
+		if( x < cols ) morphRowH<Morph>( padded + x, out + x, cols - x );
+	}
+
+	template<class Morph> __attribute__((target("sse2")))
+	static void morphV( const uchar *const *src, uchar *out, int cols )
+	{
+		int x = 0;
+		for( ; x + 16 <= cols; x += 16 )
+		{
+			__m128i m = _mm_loadu_si128( (const __m128i*)( src[0] + x ) );
+			for( int k = 1; k <= 2 * Morph::radius; k++ ) m = combine<Morph>( m, _mm_loadu_si128( (const __m128i*)( src[k] + x ) ) );
+			_mm_storeu_si128( (__m128i*)( out + x ), m );
+		}
+		morphTailV<Morph>( src, out, x, cols );
+	}
+};
+
+struct StaticAVX2
+{
+	static void grayRow( const uchar *bgr, uchar *gray, int cols ) { grayRowAVX2( bgr, gray, cols ); }
+	static int nextSet( const uchar *row, int x, int cols ) { return nextSetAVX2( row, x, cols ); }
+
+	template<class Morph> __attribute__((target("avx2")))
+	static __m256i combine( __m256i a, __m256i b ) { return Morph::erodes ? _mm256_and_si256( a, b ) : _mm256_or_si256( a, b ); }
+
+	template<class Threshold> __attribute__((target("avx2")))
+	static void blurThreshold( const uchar *g0, const uchar *g1, const uchar *g2, uchar *dark, int cols )
+	{
+		const __m256i limit = _mm256_set1_epi16( (short)( Threshold::limit + 1 ) );
+		const uchar *g[3] = { g0, g1, g2 };
+		int x = 0;
+		for( ; x + 32 <= cols; x += 32 )
+		{
+			__m256i lo = _mm256_setzero_si256(), hi = lo;
+			for( int r = 0; r < 3; r++ )
+				for( int k = 0; k < 3; k++ )
+				{
+					lo = _mm256_add_epi16( lo, _mm256_cvtepu8_epi16( _mm_loadu_si128( (const __m128i*)( g[r] + x + k ) ) ) );
+					hi = _mm256_add_epi16( hi, _mm256_cvtepu8_epi16( _mm_loadu_si128( (const __m128i*)( g[r] + x + 16 + k ) ) ) );
+				}
+			__m256i m = _mm256_packs_epi16( _mm256_cmpgt_epi16( limit, lo ), _mm256_cmpgt_epi16( limit, hi ) );
+			_mm256_storeu_si256( (__m256i*)( dark + x ), _mm256_permute4x64_epi64( m, 0xD8 ) );
+		}
+		if( x < cols ) StaticSSE2::blurThreshold<Threshold>( g0 + x, g1 + x, g2 + x, dark + x, cols - x );
+	}
+
+	template<class Morph> __attribute__((target("avx2")))
+	static void morphH( const uchar *padded, uchar *out, int cols )
+	{
+		int x = 0;
+		for( ; x + 32 <= cols; x += 32 )
+		{
+			__m256i m = _mm256_loadu_si256( (const __m256i*)( padded + x ) );
+			for( int k = 1; k <= 2 * Morph::radius; k++ ) m = combine<Morph>( m, _mm256_loadu_si256( (const __m256i*)( padded + x + k ) ) );
+			_mm256_storeu_si256( (__m256i*)( out + x ), m );
+		}
+		if( x < cols ) StaticSSE2::morphH<Morph>( padded + x, out + x, cols - x );
+	}
+
+	template<class Morph> __attribute__((target("avx2")))
+	static void morphV( const uchar *const *src, uchar *out, int cols )
+	{
+		int x = 0;
+		for( ; x + 32 <= cols; x += 32 )
+		{
+			__m256i m = _mm256_loadu_si256( (const __m256i*)( src[0] + x ) );
+			for( int k = 1; k <= 2 * Morph::radius; k++ ) m = combine<Morph>( m, _mm256_loadu_si256( (const __m256i*)( src[k] + x ) ) );
+			_mm256_storeu_si256( (__m256i*)( out + x ), m );
+		}
+		morphTailV<Morph>( src, out, x, cols );
+	}
+};
+#endif
+
+#ifdef AOSS_HAVE_NEON
+struct StaticNEON
+{
+	static void grayRow( const uchar *bgr, uchar *gray, int cols ) { grayRowNEON( bgr, gray, cols ); }
+	static int nextSet( const uchar *row, int x, int cols ) { return nextSetNEON( row, x, cols ); }
+
+	template<class Morph>
+	static uint8x16_t combine( uint8x16_t a, uint8x16_t b ) { return Morph::erodes ? vandq_u8( a, b ) : vorrq_u8( a, b ); }
+
+	template<class Threshold>
+	static void blurThreshold( const uchar *g0, const uchar *g1, const uchar *g2, uchar *dark, int cols )
+	{
+		const uint16x8_t limit = vdupq_n_u16( (uint16_t)Threshold::limit );
+		const uchar *g[3] = { g0, g1, g2 };
+		int x = 0;
+		for( ; x + 16 <= cols; x += 16 )
+		{
+			uint16x8_t lo = vdupq_n_u16( 0 ), hi = lo;
+			for( int r = 0; r < 3; r++ )
+				for( int k = 0; k < 3; k++ )
+				{
+					uint8x16_t v = vld1q_u8( g[r] + x + k );
+					lo = vaddw_u8( lo, vget_low_u8( v ) );
+					hi = vaddw_u8( hi, vget_high_u8( v ) );
+				}
+			vst1q_u8( dark + x, vcombine_u8( vmovn_u16( vcleq_u16( lo, limit ) ), vmovn_u16( vcleq_u16( hi, limit ) ) ) );
+		}
+		if( x < cols ) blurThresholdRow<Threshold>( g0 + x, g1 + x, g2 + x, dark + x, cols - x );
+	}
+
+	template<class Morph>
+	static void morphH( const uchar *padded, uchar *out, int cols )
+	{
+		int x = 0;
+		for( ; x + 16 <= cols; x += 16 )
+		{
+			uint8x16_t m = vld1q_u8( padded + x );
+			for( int k = 1; k <= 2 * Morph::radius; k++ ) m = combine<Morph>( m, vld1q_u8( padded + x + k ) );
+			vst1q_u8( out + x, m );
+		}
+		if( x < cols ) morphRowH<Morph>( padded + x, out + x, cols - x );
+	}
+
+	template<class Morph>
+	static void morphV( const uchar *const *src, uchar *out, int cols )
+	{
+		int x = 0;
+		for( ; x + 16 <= cols; x += 16 )
+		{
+			uint8x16_t m = vld1q_u8( src[0] + x );
+			for( int k = 1; k <= 2 * Morph::radius; k++ ) m = combine<Morph>( m, vld1q_u8( src[k] + x ) );
+			vst1q_u8( out + x, m );
+		}
+		morphTailV<Morph>( src, out, x, cols );
+	}
+};
+#endif
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// STATIC PIPELINE /////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Same stages and ring buffers as ScanlinePipeline, with every parameter
+// fixed by the policy types: kernel loops have constant trip counts, rows are
+// padded so the border needs no special case, and the view policy decides at
+// compile time whether the skin filter view is written. The row loop is
+// instantiated once per instruction set; allocate() picks the one matching
+// the kernels() variant, so rows call the specialized bodies directly
+template<class Threshold, class Skin, class Erode, class Dilate, class Views>
+class StaticPipeline
+{
+public:
+	static constexpr int E = Erode::radius;
+	static constexpr int D = Dilate::radius;
+	static constexpr int latency = 1 + E + D;
+
+	StaticPipeline() : rows(0), cols(0), pass(NULL) {}
+
+	void run( cv::Mat *frame, cv::Mat *finalMask, cv::Mat *skinView, std::vector<Blob> *blobs )
+	{
+		rows = frame->rows;
+		if( frame->cols != cols ) allocate( frame->cols );
+
+		finalMask->create( rows, cols, CV_8UC1 );
+		Views::prepare( skinView, rows, cols );
+		labeler.reset();
+
+		(this->*pass)( frame, finalMask, skinView );
+
+		labeler.finish( blobs );
+	}
+
+private:
+	typedef void (StaticPipeline::*Pass)( cv::Mat *frame, cv::Mat *finalMask, cv::Mat *skinView );
+
+	int rows, cols;
+	HsvTables hsv;
+	RowLabeler labeler;
+	Pass pass;                      // Row loop of the instruction set picked by allocate()
+
+	std::vector<uchar> grayRing;    // 3 rows of cols+2, reflected border
+	std::vector<uchar> erodeRing;   // 2E+1 rows of cols
+	std::vector<uchar> dilateRing;  // 2D+1 rows of cols
+	std::vector<uchar> maskLine;    // cols+2E, replicated border
+	std::vector<uchar> erodedLine;  // cols+2D, replicated border
+	std::vector<uchar> dark;
+
+	void allocate( int c )
+	{
+		cols = c;
+		grayRing.assign( 3 * ( cols + 2 ), 0 );
+		erodeRing.assign( ( 2*E + 1 ) * cols, 0 );
+		dilateRing.assign( ( 2*D + 1 ) * cols, 0 );
+		maskLine.assign( cols + 2*E, 0 );
+		erodedLine.assign( cols + 2*D, 0 );
+		dark.assign( cols, 0 );
+		pass = pick( kernels()->name );
+	}
+
+	static Pass pick( const std::string &isa )
+	{
+#ifdef AOSS_HAVE_X86
+		if( isa == "avx2" ) return &StaticPipeline::scan<StaticAVX2>;
+		if( isa == "sse2" ) return &StaticPipeline::scan<StaticSSE2>;
+#endif
+#ifdef AOSS_HAVE_NEON
+		if( isa == "neon" ) return &StaticPipeline::scan<StaticNEON>;
+#endif
+		return &StaticPipeline::scan<StaticScalar>;
+	}
+
+	uchar* grayAt( int y )   { return &grayRing[ ( y % 3 ) * ( cols + 2 ) ]; }
+	uchar* erodeAt( int y )  { return &erodeRing[ ( y % ( 2*E + 1 ) ) * cols ]; }
+	uchar* dilateAt( int y ) { return &dilateRing[ ( y % ( 2*D + 1 ) ) * cols ]; }
+
+	template<class Isa>
+	void scan( cv::Mat *frame, cv::Mat *finalMask, cv::Mat *skinView )
+	{
+		for( int y = 0; y < rows + latency; y++ )
+		{
+			if( y < rows ) grayRow<Isa>( frame, y );
+
+			int ym = y - 1;
+			if( ym >= 0 && ym < rows ) maskRow<Isa>( frame, skinView, ym );
+
+			int ye = ym - E;
+			if( ye >= 0 && ye < rows ) erodeRow<Isa>( ye );
+
+			int yd = ye - D;
+			if( yd >= 0 && yd < rows ) dilateRow<Isa>( finalMask, yd );
+		}
+	}
+
+	template<class Isa>
+	void grayRow( cv::Mat *frame, int y )
+	{
+		uchar *dst = grayAt(y);
+		Isa::grayRow( frame->ptr<uchar>(y), dst + 1, cols );
+		padReflect( dst, cols );
+	}
+
+	template<class Isa>
+	void maskRow( cv::Mat *frame, cv::Mat *skinView, int y )
+	{
+		const uchar *bgr = frame->ptr<uchar>(y);
+		uchar *line = &maskLine[E];
+
+		// Blur + threshold over the whole row
+		Isa::template blurThreshold<Threshold>( grayAt( reflect101( y - 1, rows ) ), grayAt(y), grayAt( reflect101( y + 1, rows ) ), &dark[0], cols );
+
+		// Skin filter, only where the pixel is dark
+		std::fill( line, line + cols, 0 );
+		for( int x = Isa::nextSet( &dark[0], 0, cols ); x < cols; x = Isa::nextSet( &dark[0], x + 1, cols ) )
+			line[x] = Skin::apply( hsv, bgr + 3*x );
+
+		Views::skinRow( skinView, y, line, cols );
+
+		padReplicate( &maskLine[0], cols, E );
+		Isa::template morphH<Erode>( &maskLine[0], erodeAt(y), cols );
+	}
+
+	template<class Isa>
+	void erodeRow( int y )
+	{
+		const uchar *src[2*E + 1];
+		for( int i = 0; i <= 2*E; i++ ) src[i] = erodeAt( std::min( std::max( y - E + i, 0 ), rows - 1 ) );
+
+		Isa::template morphV<Erode>( src, &erodedLine[D], cols );
+		padReplicate( &erodedLine[0], cols, D );
+		Isa::template morphH<Dilate>( &erodedLine[0], dilateAt(y), cols );
+	}
+
+	template<class Isa>
+	void dilateRow( cv::Mat *finalMask, int y )
+	{
+		const uchar *src[2*D + 1];
+		for( int i = 0; i <= 2*D; i++ ) src[i] = dilateAt( std::min( std::max( y - D + i, 0 ), rows - 1 ) );
+
+		uchar *dst = finalMask->ptr<uchar>(y);
+		Isa::template morphV<Dilate>( src, dst, cols );
+		labeler.pushRow( y, dst, cols );
+	}
+};
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// SELF-TEST ///////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+inline bool sameImage( const cv::Mat &a, const cv::Mat &b )
+{
+	if( a.size() != b.size() || a.type() != b.type() ) return false;
+	for( int y = 0; y < a.rows; y++ )
+		if( !std::equal( a.ptr<uchar>(y), a.ptr<uchar>(y) + a.cols * a.elemSize(), b.ptr<uchar>(y) ) ) return false;
+	return true;
+}
+
+template<class Pipeline>
+inline bool selfTestStaticPipeline()
+{
+	// Runs the pipeline once per available kernel variant, each time on a new
+	// instance so it picks that variant's row bodies, and compares the masks
+	// with the scalar ones on frames of dark boxes and scattered pixels
+
+	const int widths[] = { 1, 15, 17, 33, 65, 127, 640, 1921 };
+	const int nWidths  = sizeof(widths) / sizeof(widths[0]);
+	const int rows     = 40;
+
+	std::vector<const PixelKernels*> list;
+	availableKernels( &list );
+	const PixelKernels *active = kernels();
+
+	std::vector<cv::Mat> frames;
+	cv::RNG rng( 12345 );
+	for( int wi = 0; wi < nWidths; wi++ )
+	{
+		cv::Mat frame( rows, widths[wi], CV_8UC3, cv::Scalar( 200, 200, 200 ) );
+		for( int i = 0; i < 12; i++ )
+		{
+			cv::Point a( rng.uniform( 0, frame.cols ), rng.uniform( 0, rows ) );
+			cv::Point b( a.x + rng.uniform( 0, 40 ), a.y + rng.uniform( 0, 20 ) );
+			int level = rng.uniform( 0, 60 );   // Gray passes the skin filter
+			cv::rectangle( frame, a, b, cv::Scalar( level, level, level ), CV_FILLED );
+		}
+		for( int i = 0; i < frame.cols * rows / 8; i++ )
+		{
+			// Levels around the threshold, and a few colors
+			uchar *p = frame.ptr<uchar>( rng.uniform( 0, rows ) ) + 3 * rng.uniform( 0, frame.cols );
+			p[0] = p[1] = p[2] = (uchar)rng.uniform( 30, 60 );
+			if( i % 8 == 0 ) p[ i % 3 ] = (uchar)rng.uniform( 0, 256 );
+		}
+		frames.push_back( frame );
+	}
+
+	std::vector<cv::Mat> refMasks( nWidths ), refViews( nWidths );
+	std::vector<Blob> blobs;
+	bool allOk = true;
+
+	for( size_t v = 0; v < list.size(); v++ )
+	{
+		*kernelSlot() = list[v];
+		bool ok = true;
+
+		for( int wi = 0; wi < nWidths; wi++ )
+		{
+			Pipeline pipeline;
+			cv::Mat mask, view;
+			pipeline.run( &frames[wi], &mask, &view, &blobs );
+
+			if( v == 0 )
+			{
+				refMasks[wi] = mask;
+				refViews[wi] = view;
+				continue;
+			}
+			ok = ok && sameImage( mask, refMasks[wi] ) && sameImage( view, refViews[wi] );
+		}
+
+		if( v > 0 ) std::cout << "Static pipeline " << list[v]->name << ": " << ( ok ? "OK" : "MISMATCH" ) << std::endl;
+		allOk = allOk && ok;
+	}
+
+	*kernelSlot() = active;
+	return allOk;
+}
+
+#endif
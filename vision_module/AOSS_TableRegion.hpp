@@ -0,0 +1,132 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// AOSS Vision Module - Marco Lancini (www.marcolancini.it)
+//
+//
+// Copyright (C) 2012 Marco Lancini
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef AOSS_TABLE_REGION_HPP
+#define AOSS_TABLE_REGION_HPP
+
+#include <vector>
+#include <algorithm>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// TABLE REGION ////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Finds the white table in the frame, so that the analysis can skip the floor
+// and background around it (and the dark blobs they produce). The table is
+// the biggest bright region of a reduced gray frame; its convex hull, so that
+// objects and hands on the border do not cut into it, becomes the polygon,
+// and the bounding box of the polygon the crop. Until a table is found, or
+// when none is, the whole frame is used.
+class TableRegion
+{
+public:
+	int scale;                      // Detection runs at 1/scale of the frame size
+	int minBrightness;              // Darkest table accepted, on the Otsu threshold
+	double minFraction;             // Smallest table accepted, as a fraction of the frame
+
+	TableRegion() : scale(4), minBrightness(100), minFraction(0.2), found(false), checkedAt(-1) {}
+
+	// Frame area the analysis should look at
+	cv::Rect rect() const { return crop; }
+	const std::vector<cv::Point>& polygon() const { return hull; }
+	bool valid() const { return found; }
+
+	bool due( int frameNum, int interval ) const
+	{
+		// On the first frame, then every `interval` frames (0 never again)
+		if( checkedAt < 0 ) return true;
+		return interval > 0 && frameNum - checkedAt >= interval;
+	}
+
+	bool calibrate( const cv::Mat *frame, int frameNum )
+	{
+		// Looks for the table in a BGR frame; keeps the previous region if
+		// there is none. Returns true if a table was found
+
+		checkedAt = frameNum;
+		if( crop.area() == 0 || crop.br().x > frame->cols || crop.br().y > frame->rows )
+		{
+			crop  = cv::Rect( 0, 0, frame->cols, frame->rows );
+			found = false;
+			hull.clear();
+		}
+
+		cv::resize( *frame, small, cv::Size( std::max( 1, frame->cols / scale ), std::max( 1, frame->rows / scale ) ), 0, 0, cv::INTER_AREA );
+		cv::cvtColor( small, gray, CV_BGR2GRAY );
+
+		// Table against background, whatever the lighting
+		double level = cv::threshold( gray, bright, 0, 255, cv::THRESH_BINARY | cv::THRESH_OTSU );
+		if( level < minBrightness ) return false;
+
+		// Outer border of the biggest bright region; the objects are holes in it
+		std::vector<std::vector<cv::Point> > contours;
+		cv::findContours( bright, contours, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE );
+
+		int best = -1;
+		double bestArea = minFraction * gray.rows * gray.cols;
+		for( size_t i = 0; i < contours.size(); i++ )
+		{
+			double a = cv::contourArea( cv::Mat( contours[i] ) );
+			if( a >= bestArea ) { bestArea = a; best = (int)i; }
+		}
+		if( best < 0 ) return false;
+
+		std::vector<cv::Point> convex, simple;
+		cv::convexHull( cv::Mat( contours[best] ), convex );
+		cv::approxPolyDP( cv::Mat( convex ), simple, 0.01 * cv::arcLength( cv::Mat( convex ), true ), true );
+
+		// Back to frame coordinates; the reduced pixel covers scale x scale
+		hull.resize( simple.size() );
+		for( size_t i = 0; i < simple.size(); i++ )
+			hull[i] = cv::Point( simple[i].x * scale + scale / 2, simple[i].y * scale + scale / 2 );
+
+		crop  = cv::boundingRect( cv::Mat( hull ) ) & cv::Rect( 0, 0, frame->cols, frame->rows );
+		found = crop.area() > 0;
+		if( !found ) crop = cv::Rect( 0, 0, frame->cols, frame->rows );
+		return found;
+	}
+
+	bool contains( cv::Point2f p ) const
+	{
+		// p in frame coordinates; anything is inside when no table was found
+		return !found || cv::pointPolygonTest( cv::Mat( hull ), p, false ) >= 0;
+	}
+
+private:
+	bool found;
+	int checkedAt;                  // Frame of the last calibration, -1 before the first
+	cv::Rect crop;
+	std::vector<cv::Point> hull;
+
+	cv::Mat small, gray, bright;
+};
+
+#endif
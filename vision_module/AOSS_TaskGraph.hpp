@@ -0,0 +1,210 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// AOSS Vision Module - Marco Lancini (www.marcolancini.it)
+//
+//
+// Copyright (C) 2012 Marco Lancini
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef AOSS_TASK_GRAPH_HPP
+#define AOSS_TASK_GRAPH_HPP
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// TASK GRAPH //////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// A fixed set of stages with their dependencies, run again and again. Each
+// run() executes every node once, as soon as the nodes it depends on are
+// done, on a small pool of threads that includes the caller. Every node is
+// timed, and the longest chain of dependent nodes of each run (the critical
+// path, the shortest the run could take on unlimited cores) is kept next to
+// the measured wall time.
+class TaskGraph
+{
+public:
+	typedef std::function<void()> Task;
+
+	// threads counts the caller of run()
+	explicit TaskGraph( int threads ) : stopping(false), left(0), runs(0), wallMs(0), criticalMs(0)
+	{
+		for( int i = 1; i < threads; i++ ) workers.push_back( std::thread( &TaskGraph::loop, this ) );
+	}
+
+	~TaskGraph()
+	{
+		{
+			std::lock_guard<std::mutex> guard( lock );
+			stopping = true;
+		}
+		wake.notify_all();
+		for( size_t i = 0; i < workers.size(); i++ ) workers[i].join();
+	}
+
+	// Nodes are added before the first run, each after the nodes it depends
+	// on; the returned index is what later nodes list in `after`
+	int add( const std::string &name, Task task, const std::vector<int> &after = std::vector<int>() )
+	{
+		Node n;
+		n.name    = name;
+		n.task    = task;
+		n.after   = after;
+		n.waiting = 0;
+		n.ms      = 0;
+
+		int id = (int)nodes.size();
+		for( size_t i = 0; i < after.size(); i++ ) nodes[ after[i] ].next.push_back( id );
+		nodes.push_back( n );
+
+		if( !totals.count( name ) ) order.push_back( name );
+		totals[name];
+		return id;
+	}
+
+	// Returns when every node has run
+	void run()
+	{
+		Clock::time_point start = Clock::now();
+		{
+			std::lock_guard<std::mutex> guard( lock );
+			left = (int)nodes.size();
+			for( size_t i = 0; i < nodes.size(); i++ )
+			{
+				nodes[i].waiting = (int)nodes[i].after.size();
+				if( nodes[i].waiting == 0 ) ready.push_back( (int)i );
+			}
+		}
+		wake.notify_all();
+		work( true );
+
+		// Critical path: nodes were added after their dependencies
+		std::vector<double> finish( nodes.size() );
+		double critical = 0;
+		for( size_t i = 0; i < nodes.size(); i++ )
+		{
+			double before = 0;
+			for( size_t a = 0; a < nodes[i].after.size(); a++ ) before = std::max( before, finish[ nodes[i].after[a] ] );
+			finish[i] = before + nodes[i].ms;
+			critical  = std::max( critical, finish[i] );
+			totals[ nodes[i].name ] += nodes[i].ms;
+		}
+
+		runs++;
+		criticalMs += critical;
+		wallMs     += std::chrono::duration<double, std::milli>( Clock::now() - start ).count();
+	}
+
+	// Mean per run: wall time, critical path, and the time of each stage
+	// (nodes sharing a name are added up)
+	void report( std::ostream &out, const std::string &title ) const
+	{
+		if( runs == 0 ) return;
+
+		double work = 0;
+		for( size_t i = 0; i < order.size(); i++ ) work += totals.at( order[i] );
+
+		out << std::fixed << std::setprecision(3)
+			<< title << ": " << runs << " runs, " << wallMs / runs << " ms wall, "
+			<< criticalMs / runs << " ms critical path, " << work / runs << " ms of work on "
+			<< workers.size() + 1 << " threads" << std::endl;
+		for( size_t i = 0; i < order.size(); i++ )
+			out << std::setw(16) << order[i] << std::setw(10) << totals.at( order[i] ) / runs << " ms" << std::endl;
+	}
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	struct Node
+	{
+		std::string name;
+		Task task;
+		std::vector<int> after;     // Nodes this one waits for
+		std::vector<int> next;      // Nodes waiting for this one
+		int waiting;                // Of `after`, those not done yet in this run
+		double ms;                  // Time of the last run
+	};
+
+	std::vector<Node> nodes;
+	std::vector<std::thread> workers;
+
+	std::mutex lock;                // Guards ready, left, waiting and stopping
+	std::condition_variable wake;
+	std::deque<int> ready;
+	bool stopping;
+	int left;                       // Nodes not done yet in this run
+
+	// Statistics, touched by run() only
+	long runs;
+	double wallMs, criticalMs;
+	std::map<std::string, double> totals;
+	std::vector<std::string> order;
+
+	void loop() { work( false ); }
+
+	void work( bool caller )
+	{
+		// The caller leaves when the run is over, the workers when stopping
+
+		std::unique_lock<std::mutex> guard( lock );
+		while( true )
+		{
+			if( caller ? left == 0 : stopping ) return;
+			if( ready.empty() )
+			{
+				wake.wait( guard );
+				continue;
+			}
+
+			int id = ready.front();
+			ready.pop_front();
+			guard.unlock();
+
+			Clock::time_point start = Clock::now();
+			nodes[id].task();
+			nodes[id].ms = std::chrono::duration<double, std::milli>( Clock::now() - start ).count();
+
+			guard.lock();
+			for( size_t i = 0; i < nodes[id].next.size(); i++ )
+			{
+				int n = nodes[id].next[i];
+				if( --nodes[n].waiting == 0 ) ready.push_back( n );
+			}
+			left--;
+			wake.notify_all();
+		}
+	}
+};
+
+#endif
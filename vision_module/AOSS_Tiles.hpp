@@ -0,0 +1,333 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// AOSS Vision Module - Marco Lancini (www.marcolancini.it)
+//
+//
+// Copyright (C) 2012 Marco Lancini
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef AOSS_TILES_HPP
+#define AOSS_TILES_HPP
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+#include <opencv2/core/core.hpp>
+
+#include "AOSS_Blobs.hpp"
+#include "AOSS_Kernels.hpp"
+#include "AOSS_Scanline.hpp"
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// TILE PIPELINE ///////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Incremental version of the per-pixel chain for a mostly static scene. The
+// frame is split in tiles; a tile is dirty when some pixel moved by more than
+// `tolerance` from the frame it was last computed on. Only the dirty tiles,
+// grown by the halo each stage needs (1 pixel for the blur, then the erosion
+// and dilation radii), are recomputed; the threshold, skin and morphology
+// results everywhere else are kept from the previous frames. Blobs that do
+// not touch the recomputed area are kept too, and only the rest of the mask
+// is labeled again. With tolerance 0 the result is the same as a full pass.
+class TilePipeline
+{
+public:
+	int thresh;                     // Dark threshold (inverted binary)
+	int maxH, maxS, maxV;           // Skin limits, see skinPixels()
+	int erosion, dilation;          // Radii of the rectangular kernels
+	int tile;                       // Tile side, larger than the halo
+	int tolerance;                  // Largest change of a channel that is ignored
+
+	int dirtyTiles, totalTiles;     // Statistics of the last frame
+
+	TilePipeline( int thresh_, int erosion_, int dilation_, int tile_ = 32, int tolerance_ = 8 )
+		: thresh(thresh_), maxH(18), maxS(50), maxV(80), erosion(erosion_), dilation(dilation_),
+		  tile(tile_), tolerance(tolerance_), dirtyTiles(0), totalTiles(0), rows(0), cols(0) {}
+
+	void run( cv::Mat *frame, cv::Mat *finalMask, cv::Mat *skinView, std::vector<Blob> *blobs )
+	{
+		// frame is 8-bit BGR; skinView may be NULL
+
+		k = kernels();
+		bool full = ( frame->rows != rows || frame->cols != cols );
+		if( full ) allocate( frame );
+
+		findDirtyTiles( frame, full );
+
+		// Stage by stage, so each one reads the updated output of the previous
+		int halo = 1;
+		forDirtyTiles( halo, [&]( cv::Rect r ) { maskRect( frame, r ); } );
+		halo += erosion;
+		forDirtyTiles( halo, [&]( cv::Rect r ) { morphRect( &mask, &eroded, r, erosion, true ); } );
+		halo += dilation;
+		forDirtyTiles( halo, [&]( cv::Rect r ) { morphRect( &eroded, &output, r, dilation, false ); } );
+
+		relabel( halo, full );
+		*blobs = current;
+
+		output.copyTo( *finalMask );
+		if( skinView ) mask.copyTo( *skinView );
+	}
+
+private:
+	int rows, cols, tilesX, tilesY;
+	HsvTables hsv;
+	const PixelKernels *k;
+
+	cv::Mat reference;              // Frame each tile was last computed on
+	cv::Mat mask;                   // Threshold minus skin, before the morphology
+	cv::Mat eroded;
+	cv::Mat output;
+	std::vector<uchar> dirty;       // Per tile
+	std::vector<uchar> relabelMap;  // Per tile, area labeled again
+	std::vector<Blob> current;
+
+	std::vector<uchar> gray, line, tmp;
+	std::vector<Run> runs;
+	std::vector<int> labels;
+
+	void allocate( cv::Mat *frame )
+	{
+		rows = frame->rows;
+		cols = frame->cols;
+		tilesX = ( cols + tile - 1 ) / tile;
+		tilesY = ( rows + tile - 1 ) / tile;
+
+		frame->copyTo( reference );
+		mask.create( rows, cols, CV_8UC1 );
+		eroded.create( rows, cols, CV_8UC1 );
+		output.create( rows, cols, CV_8UC1 );
+		current.clear();
+	}
+
+	cv::Rect tileRect( int tx, int ty, int halo ) const
+	{
+		cv::Rect r( tx * tile - halo, ty * tile - halo, tile + 2*halo, tile + 2*halo );
+		return r & cv::Rect( 0, 0, cols, rows );
+	}
+
+	template<class F>
+	void forDirtyTiles( int halo, F f )
+	{
+		for( int ty = 0; ty < tilesY; ty++ )
+			for( int tx = 0; tx < tilesX; tx++ )
+				if( dirty[ ty * tilesX + tx ] ) f( tileRect( tx, ty, halo ) );
+	}
+
+	// CHANGE MAP //////////////////////////////////////////////////////////////
+	void findDirtyTiles( cv::Mat *frame, bool full )
+	{
+		totalTiles = tilesX * tilesY;
+		dirty.assign( totalTiles, full ? 1 : 0 );
+		dirtyTiles = full ? totalTiles : 0;
+		if( full ) return;
+
+		for( int ty = 0; ty < tilesY; ty++ )
+		{
+			for( int tx = 0; tx < tilesX; tx++ )
+			{
+				cv::Rect r = tileRect( tx, ty, 0 );
+				if( !tileChanged( frame, r ) ) continue;
+
+				dirty[ ty * tilesX + tx ] = 1;
+				dirtyTiles++;
+
+				// The tile is now computed on this frame
+				for( int y = r.y; y < r.y + r.height; y++ )
+					memcpy( reference.ptr<uchar>(y) + 3*r.x, frame->ptr<uchar>(y) + 3*r.x, 3*r.width );
+			}
+		}
+	}
+
+	bool tileChanged( cv::Mat *frame, cv::Rect r ) const
+	{
+		for( int y = r.y; y < r.y + r.height; y++ )
+		{
+			const uchar *a = frame->ptr<uchar>(y) + 3*r.x;
+			const uchar *b = reference.ptr<uchar>(y) + 3*r.x;
+			if( memcmp( a, b, 3*r.width ) == 0 ) continue;
+
+			for( int i = 0; i < 3*r.width; i++ )
+				if( std::abs( a[i] - b[i] ) > tolerance ) return true;
+		}
+		return false;
+	}
+
+	// STAGES //////////////////////////////////////////////////////////////////
+	void maskRect( cv::Mat *frame, cv::Rect r )
+	{
+		// Blur, threshold and skin subtraction of r, as ScanlinePipeline does
+
+		int gw = r.width + 2;
+		gray.resize( ( r.height + 2 ) * gw );
+		for( int j = 0; j < r.height + 2; j++ )
+		{
+			const uchar *src = frame->ptr<uchar>( reflect101( r.y - 1 + j, rows ) );
+			for( int i = 0; i < gw; i++ ) gray[ j*gw + i ] = grayPixel( src + 3 * reflect101( r.x - 1 + i, cols ) );
+		}
+
+		for( int y = 0; y < r.height; y++ )
+		{
+			const uchar *g0 = &gray[ y*gw ], *g1 = g0 + gw, *g2 = g1 + gw;
+			const uchar *bgr = frame->ptr<uchar>( r.y + y ) + 3*r.x;
+			uchar *dst = mask.ptr<uchar>( r.y + y ) + r.x;
+
+			for( int x = 0; x < r.width; x++ )
+			{
+				int sum = g0[x] + g0[x + 1] + g0[x + 2]
+						+ g1[x] + g1[x + 1] + g1[x + 2]
+						+ g2[x] + g2[x + 1] + g2[x + 2];
+				uchar m = 0;
+
+				if( ( sum + 4 ) / 9 <= thresh )
+				{
+					int h, s, v;
+					hsv.convert( bgr + 3*x, &h, &s, &v );
+					m = ( h <= maxH && s <= maxS && v <= maxV ) ? 255 : 0;
+				}
+				dst[x] = m;
+			}
+		}
+	}
+
+	void morphRect( cv::Mat *src, cv::Mat *dst, cv::Rect r, int radius, bool erode )
+	{
+		// Rectangular erosion or dilation of r. Indices are clamped to the
+		// image, which is the same as ignoring the pixels outside
+
+		int y0 = std::max( 0, r.y - radius ), y1 = std::min( rows, r.y + r.height + radius );
+		line.resize( r.width + 2*radius );
+		tmp.resize( ( y1 - y0 ) * r.width );
+
+		for( int y = y0; y < y1; y++ )
+		{
+			const uchar *s = src->ptr<uchar>(y);
+			for( int i = 0; i < r.width + 2*radius; i++ )
+				line[i] = s[ std::min( std::max( r.x - radius + i, 0 ), cols - 1 ) ];
+
+			if( erode ) k->erodeRowH( &line[0], &tmp[ ( y - y0 ) * r.width ], r.width, radius );
+			else        k->dilateRowH( &line[0], &tmp[ ( y - y0 ) * r.width ], r.width, radius );
+		}
+
+		for( int y = r.y; y < r.y + r.height; y++ )
+		{
+			int a = std::max( y0, y - radius ), b = std::min( y1 - 1, y + radius );
+			uchar *out = dst->ptr<uchar>(y) + r.x;
+
+			std::copy( &tmp[ ( a - y0 ) * r.width ], &tmp[ ( a - y0 + 1 ) * r.width ], out );
+			for( int yy = a + 1; yy <= b; yy++ )
+			{
+				if( erode ) k->andRow( out, &tmp[ ( yy - y0 ) * r.width ], r.width );
+				else        k->orRow( out, &tmp[ ( yy - y0 ) * r.width ], r.width );
+			}
+		}
+	}
+
+	// BLOBS ///////////////////////////////////////////////////////////////////
+	void markTiles( cv::Rect r )
+	{
+		r &= cv::Rect( 0, 0, cols, rows );
+		if( r.area() == 0 ) return;
+		for( int ty = r.y / tile; ty <= ( r.y + r.height - 1 ) / tile; ty++ )
+			for( int tx = r.x / tile; tx <= ( r.x + r.width - 1 ) / tile; tx++ )
+				relabelMap[ ty * tilesX + tx ] = 1;
+	}
+
+	bool touchesMarked( cv::Rect r ) const
+	{
+		r &= cv::Rect( 0, 0, cols, rows );
+		if( r.area() == 0 ) return false;
+		for( int ty = r.y / tile; ty <= ( r.y + r.height - 1 ) / tile; ty++ )
+			for( int tx = r.x / tile; tx <= ( r.x + r.width - 1 ) / tile; tx++ )
+				if( relabelMap[ ty * tilesX + tx ] ) return true;
+		return false;
+	}
+
+	void relabel( int halo, bool full )
+	{
+		// The area labeled again starts from the tiles whose final mask may
+		// have changed, and takes in every old blob that touches it (with its
+		// 8-neighborhood) until no more do: then no blob crosses its border,
+		// the blobs outside it are unchanged and those inside are complete
+
+		relabelMap.assign( tilesX * tilesY, full ? 1 : 0 );
+		forDirtyTiles( halo, [&]( cv::Rect r ) { markTiles( r ); } );
+
+		std::vector<uchar> taken( current.size(), 0 );
+		for( bool grown = true; grown; )
+		{
+			grown = false;
+			for( size_t i = 0; i < current.size(); i++ )
+			{
+				if( taken[i] ) continue;
+				cv::Rect box = current[i].box();
+				if( !touchesMarked( cv::Rect( box.x - 1, box.y - 1, box.width + 2, box.height + 2 ) ) ) continue;
+
+				markTiles( box );
+				taken[i] = 1;
+				grown = true;
+			}
+		}
+
+		// Runs of the marked area, row by row over spans of marked tiles
+		runs.clear();
+		for( int y = 0; y < rows; y++ )
+		{
+			const uchar *m   = output.ptr<uchar>(y);
+			const uchar *row = &relabelMap[ ( y / tile ) * tilesX ];
+
+			for( int tx = 0; tx < tilesX; )
+			{
+				if( !row[tx] ) { tx++; continue; }
+				int tx1 = tx;
+				while( tx1 < tilesX && row[tx1] ) tx1++;
+
+				int x = tx * tile, xe = std::min( cols, tx1 * tile );
+				while( x < xe )
+				{
+					while( x < xe && !m[x] ) x++;
+					if( x == xe ) break;
+					int x0 = x;
+					while( x < xe && m[x] ) x++;
+					Run r = { y, x0, x };
+					runs.push_back( r );
+				}
+				tx = tx1;
+			}
+		}
+
+		std::vector<Blob> fresh;
+		labelRuns( &runs, &fresh, &labels );
+
+		// Untouched blobs, then the new ones
+		std::vector<Blob> kept;
+		for( size_t i = 0; i < current.size(); i++ )
+			if( !taken[i] ) kept.push_back( current[i] );
+		kept.insert( kept.end(), fresh.begin(), fresh.end() );
+		current.swap( kept );
+	}
+};
+
+#endif
@@ -0,0 +1,233 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// AOSS Vision Module - Marco Lancini (www.marcolancini.it)
+//
+//
+// Copyright (C) 2012 Marco Lancini
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef AOSS_TRACKER_HPP
+#define AOSS_TRACKER_HPP
+
+#include <vector>
+#include <algorithm>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/flann/any.h>
+
+// The FLANN headers of OpenCV 2.3 print an empty `any` without declaring how;
+// later releases add this operator, newer compilers refuse to build without it
+#if CV_MAJOR_VERSION == 2 && CV_MINOR_VERSION < 4
+namespace cdiggins { namespace anyimpl {
+inline std::ostream& operator<<( std::ostream &out, const empty_any& ) { return out << "[empty_any]"; }
+} }
+#endif
+
+#include <opencv2/flann/flann_base.hpp>
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// OBJECT TRACKER //////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Gives each detected object an id that stays the same from frame to frame.
+// Every track predicts where its object is now (last position plus smoothed
+// velocity); each detection is then paired with the nearest free prediction
+// within `gate` pixels, closest pairs first. Few tracks are compared against
+// every detection; many are put in a FLANN kd-tree, and only the `neighbors`
+// nearest predictions of each detection are considered. A detection left
+// unpaired starts a new track, a track left unpaired for more than `maxMissed`
+// frames is dropped. swapSlots() keeps two reported objects in the same
+// order while their tracks live.
+class ObjectTracker
+{
+public:
+	struct Track
+	{
+		int id;
+		cv::Point2f pos;                // Last matched position
+		cv::Point2f vel;                // Pixels per frame, smoothed
+		int hits;                       // Frames matched
+		int missed;                     // Consecutive frames not matched
+	};
+
+	float gate;                     // Farthest match, pixels
+	int maxMissed;
+	int neighbors;                  // Candidates per detection with the kd-tree
+	int bruteForce;                 // Largest tracks x detections compared directly
+
+	ObjectTracker( float gate_ = 60, int maxMissed_ = 10 )
+		: gate(gate_), maxMissed(maxMissed_), neighbors(4), bruteForce(32 * 32), nextId(0)
+	{
+		slots[0] = slots[1] = -1;
+	}
+
+	void update( const std::vector<cv::Point2f> *detections, std::vector<int> *ids )
+	{
+		// ids[i] receives the track of detections[i]
+
+		int nd = (int)detections->size();
+		int nt = (int)tracks.size();
+		ids->assign( nd, -1 );
+
+		// Predictions
+		predicted.resize( 2 * nt );
+		for( int t = 0; t < nt; t++ )
+		{
+			predicted[2*t]     = tracks[t].pos.x + tracks[t].vel.x;
+			predicted[2*t + 1] = tracks[t].pos.y + tracks[t].vel.y;
+		}
+
+		// Candidate pairs within the gate
+		pairs.clear();
+		if( nt > 0 && nd > 0 )
+		{
+			if( (long)nt * nd <= bruteForce ) allPairs( detections );
+			else nearestPairs( detections );
+		}
+
+		// Closest first, each track and detection used once
+		std::sort( pairs.begin(), pairs.end() );
+		std::vector<int> owner( nt, -1 );
+		for( size_t p = 0; p < pairs.size(); p++ )
+		{
+			int d = pairs[p].detection, t = pairs[p].track;
+			if( (*ids)[d] >= 0 || owner[t] >= 0 ) continue;
+			owner[t] = d;
+			(*ids)[d] = tracks[t].id;
+		}
+
+		// Matched tracks follow their detection, the others age
+		std::vector<Track> alive;
+		alive.reserve( nt + nd );
+		for( int t = 0; t < nt; t++ )
+		{
+			Track tr = tracks[t];
+			if( owner[t] >= 0 )
+			{
+				cv::Point2f p = (*detections)[ owner[t] ];
+				tr.vel    = ( tr.hits > 0 ) ? 0.5f * tr.vel + 0.5f * ( p - tr.pos ) : cv::Point2f();
+				tr.pos    = p;
+				tr.hits++;
+				tr.missed = 0;
+			}
+			else if( ++tr.missed > maxMissed ) continue;
+			alive.push_back( tr );
+		}
+
+		// Births
+		for( int d = 0; d < nd; d++ )
+		{
+			if( (*ids)[d] >= 0 ) continue;
+			Track tr;
+			tr.id     = nextId++;
+			tr.pos    = (*detections)[d];
+			tr.vel    = cv::Point2f();
+			tr.hits   = 0;
+			tr.missed = 0;
+			alive.push_back( tr );
+			(*ids)[d] = tr.id;
+		}
+
+		tracks.swap( alive );
+	}
+
+	const std::vector<Track>& active() const { return tracks; }
+
+	bool swapSlots( int id1, int id2 )
+	{
+		// Tracks of the first and second reported object, -1 if none. Returns
+		// true if they must be swapped so that each stays in its slot
+		bool swap = ( id1 >= 0 && id1 == slots[1] ) || ( id2 >= 0 && id2 == slots[0] );
+		slots[0] = swap ? id2 : id1;
+		slots[1] = swap ? id1 : id2;
+		return swap;
+	}
+
+private:
+	struct Pair
+	{
+		float dist2;
+		int detection, track;
+		bool operator<( const Pair &o ) const
+		{
+			if( dist2 != o.dist2 ) return dist2 < o.dist2;
+			return detection != o.detection ? detection < o.detection : track < o.track;
+		}
+	};
+
+	std::vector<Track> tracks;
+	int nextId;
+	int slots[2];                   // Tracks last reported first and second
+	std::vector<float> predicted;   // x, y of each track
+	std::vector<Pair> pairs;
+
+	void allPairs( const std::vector<cv::Point2f> *detections )
+	{
+		float g2 = gate * gate;
+		for( size_t d = 0; d < detections->size(); d++ )
+		{
+			for( size_t t = 0; t < tracks.size(); t++ )
+			{
+				float dx = (*detections)[d].x - predicted[2*t], dy = (*detections)[d].y - predicted[2*t + 1];
+				float d2 = dx*dx + dy*dy;
+				if( d2 > g2 ) continue;
+				Pair p = { d2, (int)d, (int)t };
+				pairs.push_back( p );
+			}
+		}
+	}
+
+	void nearestPairs( const std::vector<cv::Point2f> *detections )
+	{
+		// Exact single kd-tree over the predictions; 2-D points need no more
+
+		int nt = (int)tracks.size();
+		int k  = std::min( neighbors, nt );
+		float g2 = gate * gate;
+
+		cvflann::Matrix<float> data( &predicted[0], nt, 2 );
+		cvflann::KDTreeSingleIndex< cvflann::L2_Simple<float> > index( data, cvflann::KDTreeSingleIndexParams( 8 ) );
+		index.buildIndex();
+
+		// Built once: the parameters are a map looked up by name
+		cvflann::SearchParams search;
+		std::vector<int> idx( k );
+		std::vector<float> d2( k );
+		for( size_t d = 0; d < detections->size(); d++ )
+		{
+			float q[2] = { (*detections)[d].x, (*detections)[d].y };
+			cvflann::KNNResultSet<float> result( k );
+			result.init( &idx[0], &d2[0] );
+			index.findNeighbors( result, q, search );
+
+			for( int j = 0; j < (int)result.size(); j++ )
+			{
+				if( d2[j] > g2 ) continue;
+				Pair p = { d2[j], (int)d, idx[j] };
+				pairs.push_back( p );
+			}
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,157 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// AOSS Vision Module - Marco Lancini (www.marcolancini.it)
+//
+//
+// Copyright (C) 2012 Marco Lancini
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef AOSS_TRAJECTORY_HPP
+#define AOSS_TRAJECTORY_HPP
+
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// TRAJECTORY STORE ////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// One position of one object
+struct TrackSample
+{
+	int32_t frame;
+	float x, y;
+	double timestamp;               // Seconds from the start of the video
+};
+
+// Fixed-capacity history of the positions of each object: one ring buffer per
+// object, allocated once, where the newest sample overwrites the oldest.
+// Memory use does not grow with the length of the session.
+class TrajectoryStore
+{
+public:
+	TrajectoryStore( int objects, int capacity )
+		: cap(capacity), rings( objects, std::vector<TrackSample>( capacity ) ), heads( objects, 0 ), counts( objects, 0 ) {}
+
+	int objects() const  { return (int)rings.size(); }
+	int capacity() const { return cap; }
+	int size( int object ) const { return counts[object]; }
+
+	void push( int object, int frame, double timestamp, cv::Point2f p )
+	{
+		TrackSample &s = rings[object][ heads[object] ];
+		s.frame = frame;
+		s.x = p.x;
+		s.y = p.y;
+		s.timestamp = timestamp;
+
+		heads[object] = ( heads[object] + 1 ) % cap;
+		if( counts[object] < cap ) counts[object]++;
+	}
+
+	// i-th sample of an object, 0 being the oldest still stored
+	const TrackSample& at( int object, int i ) const
+	{
+		return rings[object][ ( heads[object] - counts[object] + i + cap ) % cap ];
+	}
+
+	// The stored samples of an object, oldest first, as at most two spans of
+	// the ring itself: [first, first+nFirst) then [second, second+nSecond)
+	void spans( int object, const TrackSample **first, int *nFirst, const TrackSample **second, int *nSecond ) const
+	{
+		int start = ( heads[object] - counts[object] + cap ) % cap;
+		*first   = &rings[object][start];
+		*nFirst  = std::min( counts[object], cap - start );
+		*second  = &rings[object][0];
+		*nSecond = counts[object] - *nFirst;
+	}
+
+	// Samples of an object not older than `since`, oldest first
+	void recent( int object, double since, std::vector<TrackSample> *out ) const
+	{
+		out->clear();
+		int i = counts[object];
+		while( i > 0 && at( object, i - 1 ).timestamp >= since ) i--;
+		for( ; i < counts[object]; i++ ) out->push_back( at( object, i ) );
+	}
+
+	// Raw dump for offline analysis, written straight from the rings. For each
+	// object: int32 object index, int32 sample count, then the TrackSample
+	// records (native byte order), oldest first
+	bool write( FILE *f ) const
+	{
+		for( int o = 0; o < objects(); o++ )
+		{
+			const TrackSample *a, *b;
+			int na, nb;
+			spans( o, &a, &na, &b, &nb );
+
+			int32_t head[2] = { o, na + nb };
+			if( fwrite( head, sizeof(head), 1, f ) != 1 ) return false;
+			if( na && fwrite( a, sizeof(TrackSample), na, f ) != (size_t)na ) return false;
+			if( nb && fwrite( b, sizeof(TrackSample), nb, f ) != (size_t)nb ) return false;
+		}
+		return true;
+	}
+
+private:
+	int cap;
+	std::vector<std::vector<TrackSample> > rings;
+	std::vector<int> heads;         // Next slot to write
+	std::vector<int> counts;
+};
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// RENDERING ///////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+inline void drawFadingPath( cv::Mat *img, const std::vector<TrackSample> *path, double now, double window, cv::Scalar color )
+{
+	// Polyline through the samples, each segment darker the older it is; on
+	// a black background this is the same as fading it out. Frames where the
+	// object was missing have no sample and break the line
+
+	for( size_t i = 1; i < path->size(); i++ )
+	{
+		const TrackSample &a = path->at(i - 1), &b = path->at(i);
+		if( b.frame != a.frame + 1 ) continue;
+		double fade = 1.0 - ( now - b.timestamp ) / window;
+		if( fade <= 0 ) continue;
+
+		cv::line( *img, cv::Point( cvRound( a.x ), cvRound( a.y ) ), cv::Point( cvRound( b.x ), cvRound( b.y ) ), color * fade, 2, CV_AA, 0 );
+	}
+
+	if( !path->empty() )
+	{
+		const TrackSample &last = path->back();
+		cv::circle( *img, cv::Point( cvRound( last.x ), cvRound( last.y ) ), 5, color, -1, 8, 0 );
+	}
+}
+
+#endif
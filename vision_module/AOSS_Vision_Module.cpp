@@ -33,6 +33,27 @@
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
+#include "AOSS_Blobs.hpp"
+#include "AOSS_Kernels.hpp"
+#include "AOSS_Scanline.hpp"
+#include "AOSS_StaticPipeline.hpp"
+#include "AOSS_Detectors.hpp"
+#include "AOSS_Outlines.hpp"
+#include "AOSS_BlobTable.hpp"
+#include "AOSS_Benchmark.hpp"
+#include "AOSS_TaskGraph.hpp"
+#include "AOSS_Display.hpp"
+#include "AOSS_FramePool.hpp"
+#include "AOSS_PerfCounters.hpp"
+#include "AOSS_BarChart.hpp"
+#include "AOSS_Trajectory.hpp"
+#include "AOSS_ResultsSink.hpp"
+#include "AOSS_TableRegion.hpp"
+#include "AOSS_Objects.hpp"
+#include "AOSS_Tracker.hpp"
+#include "AOSS_FlowTracker.hpp"
+#include "AOSS_CamShift.hpp"
+
 using namespace std;
 using namespace cv;
 
@@ -54,6 +75,9 @@ const int dilation_size    = 3;
 const int thresh_canny     = 150;
 const float thresh_area    = 500;
 
+const int trajectory_capacity  = 4096;  // Samples kept per object
+const double trajectory_window = 5;     // Seconds of path shown in the tracking window
+
 Scalar white = Scalar( 255, 255, 255 );
 Scalar black = Scalar( 0, 0, 0 );
 Scalar blue  = Scalar( 255, 0, 0 );
@@ -69,20 +93,341 @@ Scalar darkorange = Scalar( 0, 140, 255 );
 
 
 
+////////////////////////////////////////////////////////////////////////////////
+// OPTIONS /////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// Pipelines specialized on the constants above
+typedef StaticPipeline< ThresholdInv<threshold_value>, SkinLimits<18, 50, 80>,
+						RectErode<erosion_size>, RectDilate<dilation_size>, GuiViews > GuiPipeline;
+typedef StaticPipeline< ThresholdInv<threshold_value>, SkinLimits<18, 50, 80>,
+						RectErode<erosion_size>, RectDilate<dilation_size>, HeadlessViews > HeadlessPipeline;
+
+string detector_name = "dense";         // Engine finding the objects, see registerDetectors()
+const double compare_tolerance = 3;     // Pixels between two centers that still agree, for --compare
+double display_hz = 15;         // Window refresh rate, 0 disables the windows
+bool table_crop = false;        // Analyze only the table, see TableRegion
+double table_recheck = 10;      // Seconds between two table detections, 0 only at start
+bool track_objects = false;     // Keep each object in its slot, see ObjectTracker
+int flow_interval = 0;          // Frames between full detections with optical flow, 0 detects every frame
+int camshift_interval = 0;      // Same, following the objects with CamShift
+bool huge_pages = false;        // Frame buffers on huge pages, see FramePool
+bool perf_counters = false;     // Hardware counters per stage, see StageProfile
+
+struct FrameCosts
+{
+	double detectMs, followMs;      // Finding the objects, by the detector or by the follower
+	int detected, followed;         // Detector runs, follower attempts
+	int followFailed;               // Attempts after which the detector ran too
+} frame_costs;
+
+StageProfile stage_profile;     // Filled by analyzeFrame() with --perf
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // PROTOTYPES //////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
-void analyzeFrame( Mat *frameUnderTest, Mat *gray_image, Mat *objects, Mat *tracking, Mat *chart,
-				   Mat *skin, Mat *imgHSV, Mat *planeH, Mat *planeS, Mat *planeV, Mat *imgSkin,
-				   vector<Mat> *hsv_planes, Mat *el1, Mat *el2,
+void analyzeFrame( Mat *frameUnderTest, Mat *gray_image, DisplayThread *display, FramePool *pool, int frameNum,
+				   DetectorEngine *detector, TableRegion *table, ObjectTracker *tracker, Follower *follower,
+				   TrajectoryStore *trajectory, ResultsSink *results, double timestamp, Mat *skin, BlobTable *found,
 				   int *firstidx, int *secondidx,
-				   int *p1x, int *p1y, int *p2x, int *p2y, int *distx, int *disty,
-				   int *flag, float *len, float *area,
-				   int *tot_width, int *tot_height );
+				   int *p1x, int *p1y, int *p2x, int *p2y );
 
-void skinPixels( Mat *imgBGR, Mat *imgSkin, Mat *imgHSV, vector<Mat> *hsv_planes, Mat *planeH, Mat *planeS, Mat *planeV );
-void selectBiggest( int *firstidx, int *secondidx, vector<Moments> *mu );
-void drawBarChart(Mat *chart, int tot_width, int tot_height, int p1x, int p1y, int p2x, int p2y, int distx, int disty );
+void skinPixels( Mat *imgBGR, Mat *mask );
+void registerDetectors();
+void setupWindows( Size refS );
+void renderFrame( const DisplayRecord *record, TaskGraph *views, Mat *objects, Mat *tracking, Mat *chart );
+void drawObjects( const DisplayRecord *record, Mat *objects, Size refS );
+void drawTracking( const DisplayRecord *record, Mat *tracking, Size refS );
+void drawChart( const DisplayRecord *record, Mat *chart, BarChart *barChart, Size refS );
+void selectBiggest( int *firstidx, int *secondidx, const BlobTable *found );
+void drawBarChart(Mat *chart, BarChart *barChart, int tot_width, int tot_height, int p1x, int p1y, int p2x, int p2y, int distx, int disty );
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// DETECTOR ENGINES ////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// The original detector: every stage on full 8-bit images with the OpenCV
+// functions. Its blobs are the polygons approximating the contours; contours
+// of thresh_area or less are left empty. Contours are traced into a memory
+// storage and polygons into an arena, both emptied and reused every frame
+class DenseEngine : public DetectorEngine
+{
+public:
+	DenseEngine() : storage( cvCreateMemStorage( 0 ) )
+	{
+		el1 = getStructuringElement( MORPH_RECT, Size( 2*erosion_size + 1, 2*erosion_size+1 ), Point( erosion_size, erosion_size ) );
+		el2 = getStructuringElement( MORPH_RECT, Size( 2*dilation_size + 1, 2*dilation_size+1 ), Point( dilation_size, dilation_size ) );
+	}
+
+	~DenseEngine() { cvReleaseMemStorage( &storage ); }
+
+	const char* name() const { return "dense"; }
+
+	void detect( Mat *frame, Mat *gray_image, Mat *skin, vector<Blob> *blobs )
+	{
+		// Convert to gray /////////////////////////////////////////////////////
+		cvtColor( *frame, *gray_image, CV_RGB2GRAY );
+		stageDone( "gray", frame );
+
+		// Blur ////////////////////////////////////////////////////////////////
+		blur( *gray_image, *gray_image, Size(3,3) );
+		stageDone( "blur", frame );
+
+		// Threshold ///////////////////////////////////////////////////////////
+		threshold( *gray_image, *gray_image, threshold_value, max_BINARY_value, THRESH_BINARY_INV );
+		stageDone( "threshold", frame );
+
+		// Skin Filter (detection and subtraction) /////////////////////////////
+		skinPixels( frame, gray_image );
+		stageDone( "skin", frame );
+
+		// Keep the skin filter view ////////////////////////////////////////////
+		if( skin )
+		{
+			gray_image->copyTo( *skin );
+			stageDone( "skin view", frame );
+		}
+
+		// Erode ///////////////////////////////////////////////////////////////
+		erode( *gray_image, *gray_image, el1 );
+		stageDone( "erode", frame );
+
+		// Dilate //////////////////////////////////////////////////////////////
+		dilate( *gray_image, *gray_image, el2 );
+		stageDone( "dilate", frame );
+
+		traceBlobs( gray_image, blobs );
+		stageDone( "contours", frame );
+		blobMoments( blobs );
+		stageDone( "moments", frame );
+	}
+
+	const OutlineArena* outlines() const { return &contours_poly; }
+
+protected:
+	Mat el1, el2;
+
+	void traceBlobs( Mat *mask, vector<Blob> *blobs )
+	{
+		// Find contours ///////////////////////////////////////////////////////
+		// As findContours() does, without copying each one into a vector
+		cvClearMemStorage( storage );
+		CvMat image = *mask;
+		CvSeq *first = NULL;
+		cvFindContours( &image, storage, &first, sizeof(CvContour), CV_RETR_TREE, CV_CHAIN_APPROX_SIMPLE, cvPoint(0, 0) );
+		CvSeq *contours = first ? cvTreeToNodeSeq( first, sizeof(CvSeq), storage ) : NULL;
+		int count = contours ? contours->total : 0;
+
+		// ApproxPoly + BoundingRect + Moments /////////////////////////////////
+		contours_poly.clear();
+		blobs->assign( count, Blob() );
+
+		for( int i = 0; i < count; i++ )
+		{
+			CvSeq *contour = *(CvSeq**)cvGetSeqElem( contours, i );
+
+			// Discard contours with area < threshold
+			if( fabs( cvContourArea( contour ) ) <= thresh_area )
+			{
+				contours_poly.append( NULL, 0 );
+				continue;
+			}
+
+			// Approximate contours to polygons
+			points.resize( contour->total );
+			cvCvtSeqToArray( contour, &points[0] );
+			approxPolyDP( Mat( points ), polygon, 3, true );
+			contours_poly.append( &polygon[0], (int)polygon.size() );
+
+			// Get bounding rects
+			Rect box = boundingRect( contours_poly[i].mat() );
+
+			Blob &b = (*blobs)[i];
+			b.minx = box.x;
+			b.miny = box.y;
+			b.maxx = box.x + box.width - 1;
+			b.maxy = box.y + box.height - 1;
+		}
+	}
+
+	void blobMoments( vector<Blob> *blobs )
+	{
+		// Get the moments, of all the polygons at once ////////////////////////
+		int count = (int)blobs->size();
+		m00.resize( count );
+		m10.resize( count );
+		m01.resize( count );
+		if( count ) kernels()->polygonMoments( contours_poly.xy(), contours_poly.starts(), count, &m00[0], &m10[0], &m01[0] );
+		for( int i = 0; i < count; i++ )
+		{
+			(*blobs)[i].m00 = m00[i];
+			(*blobs)[i].m10 = m10[i];
+			(*blobs)[i].m01 = m01[i];
+		}
+	}
+
+private:
+	CvMemStorage *storage;
+	vector<Point> points, polygon;  // Of the contour being approximated
+	OutlineArena contours_poly;
+	vector<double> m00, m10, m01;
+};
+
+// The dense stages on horizontal bands of the frame, run as a task graph:
+// each stage of a band starts as soon as the bands it reads are ready, so the
+// bands move through the chain on different cores. The filters of a band
+// read the rows of its neighbours (OpenCV only isolates a region when asked
+// to), so the mask is the same as the dense one. Blur and erosion write into
+// an image of their own, as a band of their input is still read by the band
+// next to it
+class GraphEngine : public DenseEngine
+{
+public:
+	GraphEngine() : bands( max( 2, (int)std::thread::hardware_concurrency() ) ), graph( bands ),
+					frame(NULL), mask(NULL), bandRows(0)
+	{
+		vector<int> gray, thresh, skin, eroded, dilated;
+		for( int b = 0; b < bands; b++ )
+			gray.push_back( graph.add( "gray", [this, b]() { grayBand( b ); } ) );
+		for( int b = 0; b < bands; b++ )
+			thresh.push_back( graph.add( "blur+threshold", [this, b]() { thresholdBand( b ); }, neighbours( gray, b ) ) );
+		for( int b = 0; b < bands; b++ )
+			skin.push_back( graph.add( "skin", [this, b]() { skinBand( b ); }, vector<int>( 1, thresh[b] ) ) );
+		for( int b = 0; b < bands; b++ )
+			eroded.push_back( graph.add( "erode", [this, b]() { erodeBand( b ); }, neighbours( skin, b ) ) );
+		for( int b = 0; b < bands; b++ )
+			dilated.push_back( graph.add( "dilate", [this, b]() { dilateBand( b ); }, neighbours( eroded, b ) ) );
+		graph.add( "contours", [this]() { traceBlobs( mask, blobs ); blobMoments( blobs ); }, dilated );
+	}
+
+	const char* name() const { return "graph"; }
+
+	void detect( Mat *frame, Mat *gray_image, Mat *skin, vector<Blob> *blobs )
+	{
+		// Bands shorter than the erosion and dilation borders are not worth it
+		if( frame->rows < bands * 8 )
+		{
+			DenseEngine::detect( frame, gray_image, skin, blobs );
+			return;
+		}
+
+		this->frame = frame;
+		this->mask  = gray_image;
+		this->blobs = blobs;
+		bandRows    = ( frame->rows + bands - 1 ) / bands;
+		gray_image->create( frame->size(), CV_8UC1 );
+		blurredImg.create( frame->size(), CV_8UC1 );
+		erodedImg.create( frame->size(), CV_8UC1 );
+
+		graph.run();
+
+		if( skin ) blurredImg.copyTo( *skin );
+	}
+
+	void report( ostream &out ) const { graph.report( out, "Detector graph" ); }
+
+private:
+	int bands;
+	TaskGraph graph;
+
+	// Frame being analyzed, for the nodes
+	Mat *frame, *mask;
+	vector<Blob> *blobs;
+	int bandRows;
+	Mat blurredImg, erodedImg;
+
+	Mat band( Mat *img, int b ) const
+	{
+		int y0 = b * bandRows;
+		return img->rowRange( min( y0, img->rows ), min( y0 + bandRows, img->rows ) );
+	}
+
+	// Nodes of the graph, one per stage and band //////////////////////////////
+	void grayBand( int b )
+	{
+		Mat in = band( frame, b ), out = band( mask, b );
+		cvtColor( in, out, CV_RGB2GRAY );
+	}
+
+	void thresholdBand( int b )
+	{
+		Mat in = band( mask, b ), out = band( &blurredImg, b );
+		blur( in, out, Size(3,3) );
+		threshold( out, out, threshold_value, max_BINARY_value, THRESH_BINARY_INV );
+	}
+
+	void skinBand( int b )
+	{
+		Mat in = band( frame, b ), out = band( &blurredImg, b );
+		skinPixels( &in, &out );
+	}
+
+	void erodeBand( int b )
+	{
+		Mat in = band( &blurredImg, b ), out = band( &erodedImg, b );
+		erode( in, out, el1 );
+	}
+
+	void dilateBand( int b )
+	{
+		Mat in = band( &erodedImg, b ), out = band( mask, b );
+		dilate( in, out, el2 );
+	}
+
+	vector<int> neighbours( const vector<int> &nodes, int b ) const
+	{
+		// The nodes of band b and of the bands above and below it
+		vector<int> n;
+		for( int i = max( 0, b - 1 ); i <= min( bands - 1, b + 1 ); i++ ) n.push_back( nodes[i] );
+		return n;
+	}
+};
+
+// The fused pipeline specialized on the constants above; frames without a
+// view go through the headless build
+class StaticEngine : public DetectorEngine
+{
+public:
+	const char* name() const { return "static"; }
+
+	void detect( Mat *frame, Mat *mask, Mat *skin, vector<Blob> *blobs )
+	{
+		if( skin ) gui.run( frame, mask, skin, blobs );
+		else headless.run( frame, mask, skin, blobs );
+	}
+
+private:
+	GuiPipeline gui;
+	HeadlessPipeline headless;
+};
+
+void registerDetectors()
+{
+	// Engines selectable with --mask and --compare, the default first
+
+	DetectorRegistry &r = detectorRegistry();
+	r.add( "dense",   "8-bit images and OpenCV functions, contours",
+		   []() -> DetectorEngine* { return new DenseEngine(); } );
+	r.add( "graph",   "same stages on row bands, run as a task graph",
+		   []() -> DetectorEngine* { return new GraphEngine(); } );
+	r.add( "packed",  "1 bit per pixel from the threshold to the labeling",
+		   []() -> DetectorEngine* { return new PackedEngine( threshold_value, erosion_size, dilation_size ); } );
+	r.add( "rle",     "runs of dark pixels from the threshold to the labeling",
+		   []() -> DetectorEngine* { return new RleEngine( threshold_value, erosion_size, dilation_size ); } );
+	r.add( "stream",  "all per-pixel stages fused row by row",
+		   []() -> DetectorEngine* { return new StreamEngine( threshold_value, erosion_size, dilation_size ); } );
+	r.add( "static",  "same, specialized at compile time",
+		   []() -> DetectorEngine* { return new StaticEngine(); } );
+	r.add( "tiles",   "only the tiles that changed since the previous frame",
+		   []() -> DetectorEngine* { return new TileEngine( threshold_value, erosion_size, dilation_size ); } );
+	r.add( "profile", "row and column sums of the mask, two objects apart",
+		   []() -> DetectorEngine* { return new ProfileEngine( threshold_value, erosion_size, dilation_size, thresh_area ); } );
+	r.add( "simpleblob", "features2d SimpleBlobDetector, no skin filter",
+		   []() -> DetectorEngine* { return new SimpleBlobEngine( threshold_value, thresh_area ); } );
+}
 
 
 
@@ -92,17 +437,110 @@ void drawBarChart(Mat *chart, int tot_width, int tot_height, int p1x, int p1y, i
 int main(int argc, char *argv[])
 {
 	// Check input /////////////////////////////////////////////////////////////
-    if (argc != 2)
+    string sourceReference;
+    string kernelName = "auto";
+    string trajectoryFile;
+    string resultsFile = "-";
+    string resultsFormat = "csv";
+    bool bench = false;
+    bool selftest = false;
+    string compareList;
+
+    registerDetectors();
+
+    for( int i = 1; i < argc; i++ )
+    {
+        const string opt = argv[i];
+        if( opt.compare( 0, 7, "--mask=" ) == 0 ) detector_name = opt.substr( 7 );
+        else if( opt.compare( 0, 10, "--compare=" ) == 0 ) compareList = opt.substr( 10 );
+        else if( opt == "--bench" )       bench = true;
+        else if( opt == "--selftest" )    selftest = true;
+        else if( opt.compare( 0, 13, "--display-hz=" ) == 0 ) display_hz = atof( opt.substr( 13 ).c_str() );
+        else if( opt.compare( 0, 10, "--kernels=" ) == 0 ) kernelName = opt.substr( 10 );
+        else if( opt.compare( 0, 13, "--trajectory=" ) == 0 ) trajectoryFile = opt.substr( 13 );
+        else if( opt.compare( 0, 10, "--results=" ) == 0 ) resultsFile = opt.substr( 10 );
+        else if( opt.compare( 0, 17, "--results-format=" ) == 0 ) resultsFormat = opt.substr( 17 );
+        else if( opt == "--table" )       table_crop = true;
+        else if( opt == "--track" )       track_objects = true;
+        else if( opt.compare( 0, 7, "--flow=" ) == 0 ) flow_interval = atoi( opt.substr( 7 ).c_str() );
+        else if( opt.compare( 0, 11, "--camshift=" ) == 0 ) camshift_interval = atoi( opt.substr( 11 ).c_str() );
+        else if( opt.compare( 0, 16, "--table-recheck=" ) == 0 ) table_recheck = atof( opt.substr( 16 ).c_str() );
+        else if( opt == "--huge-pages" )  huge_pages = true;
+        else if( opt == "--perf" )        perf_counters = true;
+        else if( opt.compare( 0, 2, "--" ) == 0 )
+        {
+            cout << "Unknown option " << opt << endl;
+            return -1;
+        }
+        else sourceReference = opt;
+    }
+
+    // Pixel kernels ///////////////////////////////////////////////////////////
+    if( !selectKernels( kernelName ) )
+    {
+        cout << "Kernels " << kernelName << " not available on this CPU" << endl;
+        return -1;
+    }
+    cout << "Pixel kernels: " << kernels()->name << endl;
+
+    if( selftest )
+    {
+        bool ok = selfTestKernels();
+        ok = selfTestStaticPipeline<GuiPipeline>() && ok;
+        return ok ? 0 : 1;
+    }
+
+    // Benchmark mode needs no video ///////////////////////////////////////////
+    if( bench )
+    {
+        benchKernels( Size(1920, 1080), 20, threshold_value, erosion_size );
+        benchMaskModes( Size(1920, 1080), 20, threshold_value, erosion_size, dilation_size );
+        benchFramePipelines<GuiPipeline, HeadlessPipeline>( Size(1920, 1080), 20, threshold_value, erosion_size, dilation_size );
+        benchTiles( Size(1920, 1080), 20, threshold_value, erosion_size, dilation_size );
+        benchProfiles( Size(1920, 1080), 20, threshold_value, erosion_size, dilation_size, thresh_area );
+        benchSkin( Size(1920, 1080), 20, threshold_value );
+        benchTopK( 20000, 50 );
+        benchTracker( 300 );
+        benchAnalyzer( Size(160, 120), 5000, 4 );
+        benchBarChart( 1080, 200 );
+        benchFramePool( Size(1920, 1080), 500 );
+        return 0;
+    }
+
+    if( sourceReference.empty() )
     {
         cout << "Not enough parameters" << endl;
-        cout << "How to use: " << argv[0] << " <path of the input video>" << endl;
+        cout << "How to use: " << argv[0] << " [--mask=" << detectorRegistry().names( "|" ) << "] <path of the input video>" << endl;
+        cout << "            " << argv[0] << " --compare=<detector>,<detector>... <path of the input video>" << endl;
+        cout << "            " << argv[0] << " --bench | --selftest" << endl;
+        cout << "Options:    --kernels=auto|scalar|sse2|avx2|neon --display-hz=<rate, 0 for no windows>" << endl;
+        cout << "            --trajectory=<file to save the paths of the objects>" << endl;
+        cout << "            --results=<file, - for stdout> --results-format=csv|jsonl|bin" << endl;
+        cout << "            --table --table-recheck=<seconds, 0 only at start> --track" << endl;
+        cout << "            --flow=<frames between full detections> | --camshift=<same>" << endl;
+        cout << "            --huge-pages --perf" << endl;
+        cout << "Detectors:" << endl;
+        for( size_t i = 0; i < detectorRegistry().entries().size(); i++ )
+            cout << "            " << setw(12) << left << detectorRegistry().entries()[i].name << right
+                 << detectorRegistry().entries()[i].description << endl;
+        return -1;
+    }
+
+    DetectorEngine *detector = detectorRegistry().create( detector_name );
+    if( !detector )
+    {
+        cout << "Unknown detector " << detector_name << ", choose among " << detectorRegistry().names( ", " ) << endl;
         return -1;
     }
 
-    const string sourceReference = argv[1];
-    char c;
     int frameNum = -1;          // Frame counter
 
+    if( flow_interval > 0 && camshift_interval > 0 )
+    {
+        cout << "Choose either --flow or --camshift" << endl;
+        return -1;
+    }
+
     // Load video //////////////////////////////////////////////////////////////
     VideoCapture captUndTst(sourceReference);
     if ( !captUndTst.isOpened())
@@ -116,41 +554,99 @@ int main(int argc, char *argv[])
     cout << "Reference frame resolution: Width=" << refS.width << "  Height=" << refS.height
     	 << " of nr#: " << captUndTst.get(CV_CAP_PROP_FRAME_COUNT) << endl;
 
+    double fps = captUndTst.get(CV_CAP_PROP_FPS);
+    if( fps <= 0 ) fps = 25;
 
-    // Windows /////////////////////////////////////////////////////////////////
-    // Frame under test
-    namedWindow( WIN_UT, CV_WINDOW_NORMAL );
-    cvMoveWindow( WIN_UT, 720, 0 );
-
-    // Skin filter
-    namedWindow( WIN_SK, CV_WINDOW_NORMAL );
-    cvMoveWindow( WIN_SK, refS.width, 0 );
-
-    // Selected contours
-    namedWindow( WIN_SQ, CV_WINDOW_NORMAL );
-    cvMoveWindow( WIN_SQ, 720, 300 );
+    // Detectors side by side on the same frames ///////////////////////////////
+    if( !compareList.empty() )
+    {
+        vector<DetectorEngine*> engines;
+        stringstream names( compareList );
+        string name;
+        bool ok = true;
+        while( getline( names, name, ',' ) )
+        {
+            DetectorEngine *e = detectorRegistry().create( name );
+            if( !e ) cout << "Unknown detector " << name << endl;
+            else engines.push_back( e );
+            ok = ok && e;
+        }
+        if( ok && !engines.empty() ) compareDetectors( &captUndTst, engines, thresh_area, compare_tolerance, cout );
+        for( size_t i = 0; i < engines.size(); i++ ) delete engines[i];
+        delete detector;
+        return ok ? 0 : -1;
+    }
 
-    // Tracking
-    namedWindow( WIN_CT, CV_WINDOW_NORMAL );
-    cvMoveWindow( WIN_CT, refS.width, 300 );
+    // Per-frame results ///////////////////////////////////////////////////////
+    ResultEncoder *encoder;
+    if( resultsFormat == "csv" )        encoder = new CsvEncoder();
+    else if( resultsFormat == "jsonl" ) encoder = new JsonLinesEncoder();
+    else if( resultsFormat == "bin" )   encoder = new BinaryEncoder();
+    else
+    {
+        cout << "Unknown results format " << resultsFormat << endl;
+        return -1;
+    }
 
-    // Bar chart
-    namedWindow( WIN_CHART, CV_WINDOW_NORMAL );
-    cvMoveWindow( WIN_CHART, 490, 0 );
-    cvResizeWindow( WIN_CHART, 220, 450 );
+    FILE *resultsOut = ( resultsFile == "-" ) ? stdout : fopen( resultsFile.c_str(), "wb" );
+    if( !resultsOut )
+    {
+        cout << "Could not open " << resultsFile << endl;
+        delete encoder;
+        return -1;
+    }
+    ResultsSink *results = new ResultsSink( resultsOut, encoder );
 
 
     ////////////////////////////////////////////////////////////////////////////
     // Allocate resources //////////////////////////////////////////////////////
     ////////////////////////////////////////////////////////////////////////////
-    Mat frameUnderTest, gray_image, objects, tracking, chart;
-    Mat skin, imgHSV, planeH, planeS, planeV, imgSkin;
-    vector<Mat> hsv_planes;
-    Mat el1, el2;
+    // Buffers of one frame, recycled between the analysis and the display
+    // thread; declared first, as it must outlive every Mat it allocates
+    FramePool pool( refS.area() * 3, huge_pages );
+
+    Mat frameUnderTest, gray_image, skin, objects, tracking, chart;
+    gray_image.allocator = &pool;
+    skin.allocator       = &pool;
     int firstidx, secondidx;
-    int p1x, p1y, p2x, p2y, distx, disty;
-    int flag=0;
-    float len, area;
+    int p1x, p1y, p2x, p2y;
+    BlobTable found;                 // Objects of the frame being analyzed
+    TrajectoryStore trajectory( 2, trajectory_capacity );
+    TableRegion table;
+    ObjectTracker tracker;
+
+    // Objects followed between two detections, if asked
+    Follower *follower = NULL;
+    if( flow_interval > 0 )          follower = new FlowTracker( flow_interval );
+    else if( camshift_interval > 0 ) follower = new CamShiftTracker( camshift_interval, threshold_value );
+
+
+    // Windows /////////////////////////////////////////////////////////////////
+    // Drawn by their own thread, at most display_hz times per second. The
+    // three views drawn from the positions do not depend on each other and
+    // are drawn at the same time
+    const DisplayRecord *drawn = NULL;
+    BarChart barChart( 400 );         // Background cached between two charts, display thread only
+    TaskGraph views( display_hz > 0 ? 3 : 1 );
+    views.add( "objects",  [&]() { drawObjects( drawn, &objects, refS ); } );
+    views.add( "tracking", [&]() { drawTracking( drawn, &tracking, refS ); } );
+    views.add( "chart",    [&]() { drawChart( drawn, &chart, &barChart, refS ); } );
+
+    DisplayThread display;
+    if( display_hz > 0 )
+        display.start( display_hz,
+                       [refS]() { setupWindows( refS ); },
+                       [&]( const DisplayRecord &record )
+                       {
+                           drawn = &record;
+                           renderFrame( &record, &views, &objects, &tracking, &chart );
+                       } );
+
+
+    // Counters of the analysis thread, if asked and if the system has them
+    if( perf_counters && !stage_profile.start() )
+        cout << "Hardware counters unavailable (" << stage_profile.why() << "), running without them" << endl;
+    if( stage_profile.active() ) detector->profileStages( &stage_profile );
 
 
     ////////////////////////////////////////////////////////////////////////////
@@ -166,20 +662,57 @@ int main(int argc, char *argv[])
             break;
         }
         ++frameNum;
-        cout << "Frame:" << " #" << frameNum << endl;
+
+        // Table region, found again now and then or when asked from a window
+        bool recheck = display.recalibrationRequested();
+        if( table_crop && ( recheck || table.due( frameNum, cvRound( table_recheck * fps ) ) ) )
+        {
+            if( !table.calibrate( &frameUnderTest, frameNum ) && ( recheck || frameNum == 0 ) )
+                cout << "No table found, analyzing the whole frame" << endl;
+        }
 
         // Analyze Frame ///////////////////////////////////////////////////////
-        analyzeFrame( &frameUnderTest, &gray_image, &objects, &tracking, &chart,
-        			  &skin, &imgHSV, &planeH, &planeS, &planeV, &imgSkin,
-        			  &hsv_planes, &el1, &el2,
+        analyzeFrame( &frameUnderTest, &gray_image, &display, &pool, frameNum,
+        			  detector, table_crop ? &table : NULL, track_objects ? &tracker : NULL,
+        			  follower, &trajectory, results, frameNum / fps, &skin, &found,
         			  &firstidx, &secondidx,
-        			  &p1x, &p1y, &p2x, &p2y, &distx, &disty,
-        			  &flag, &len, &area,
-        			  &refS.width, &refS.height );
+        			  &p1x, &p1y, &p2x, &p2y );
 
-      	// Wait for key ////////////////////////////////////////////////////////
-      	c = cvWaitKey(1);
-        if (c == 27) break;
+      	// Escape pressed on a window //////////////////////////////////////////
+        if( display.quitRequested() ) break;
+    }
+
+    display.stop();
+
+    // Write what is left of the results
+    delete results;
+    if( resultsOut != stdout ) fclose( resultsOut );
+    if( display_hz > 0 )
+    {
+        cout << "Displayed " << display.renderedFrames() << " of " << frameNum + 1 << " frames" << endl;
+        views.report( cout, "Views" );
+    }
+    pool.report( cout );
+    detector->report( cout );
+    stage_profile.report( cout );
+    delete detector;
+    if( follower )
+    {
+        follower->report( cout );
+        cout << endl << "Cost per frame: detector "
+             << ( frame_costs.detected ? frame_costs.detectMs / frame_costs.detected : 0 ) << " ms, follower "
+             << ( frame_costs.followed ? frame_costs.followMs / frame_costs.followed : 0 ) << " ms per attempt ("
+             << frame_costs.followFailed << " of " << frame_costs.followed << " attempts failed and ran the detector too)" << endl;
+        delete follower;
+    }
+
+    // Save the paths //////////////////////////////////////////////////////////
+    if( !trajectoryFile.empty() )
+    {
+        FILE *f = fopen( trajectoryFile.c_str(), "wb" );
+        bool ok = f && trajectory.write( f );
+        if( f ) ok = ( fclose( f ) == 0 ) && ok;
+        if( !ok ) cout << "Could not write " << trajectoryFile << endl;
     }
     return 0;
 }
@@ -189,227 +722,350 @@ int main(int argc, char *argv[])
 ////////////////////////////////////////////////////////////////////////////////
 // ANALYZE FRAME ///////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
-void analyzeFrame( Mat *frameUnderTest, Mat *gray_image, Mat *objects, Mat *tracking, Mat *chart,
-				   Mat *skin, Mat *imgHSV, Mat *planeH, Mat *planeS, Mat *planeV, Mat *imgSkin,
-				   vector<Mat> *hsv_planes, Mat *el1, Mat *el2,
+void analyzeFrame( Mat *frameUnderTest, Mat *gray_image, DisplayThread *display, FramePool *pool, int frameNum,
+				   DetectorEngine *detector, TableRegion *table, ObjectTracker *tracker, Follower *follower,
+				   TrajectoryStore *trajectory, ResultsSink *results, double timestamp, Mat *skin, BlobTable *found,
 				   int *firstidx, int *secondidx,
-				   int *p1x, int *p1y, int *p2x, int *p2y, int *distx, int *disty,
-				   int *flag, float *len, float *area,
-				   int *tot_width, int *tot_height )
+				   int *p1x, int *p1y, int *p2x, int *p2y )
 {
-	// Show original image /////////////////////////////////////////////////////
-	imshow( WIN_UT, *frameUnderTest );
+	// Debug views are only produced when the display thread is ready for them
+	bool render = display->wantsFrame();
 
-	// Convert to gray /////////////////////////////////////////////////////////
-	*gray_image = Mat::zeros( frameUnderTest->size(), CV_8UC3 );
-	cvtColor( *frameUnderTest, *gray_image, CV_RGB2GRAY );
+	// Only the table is analyzed; positions are reported in frame coordinates
+	Rect crop = table ? table->rect() : Rect( Point(), frameUnderTest->size() );
+	Mat onTable = (*frameUnderTest)( crop );
 
-	// Blur ////////////////////////////////////////////////////////////////////
-	blur( *gray_image, *gray_image, Size(3,3) );
+	const OutlineArena *outlines = NULL;     // Polygons of the blobs, from the engines that trace them
 
-	// Threshold ///////////////////////////////////////////////////////////////
-	threshold( *gray_image, *gray_image, threshold_value, max_BINARY_value, THRESH_BINARY_INV );
+	// Objects of this frame, bigger than thresh_area
+	found->clear();
 
-	// Skin Filter (detection and subtraction) /////////////////////////////////
-	skinPixels( frameUnderTest, imgSkin, imgHSV, hsv_planes, planeH, planeS, planeV );
-	subtract( *gray_image, *imgSkin, *gray_image );
+	// Each stage is counted on the pixels of the table, see StageProfile; the
+	// engines with separate stages count each of them, the rest of the
+	// detector goes on its own line
+	double pixels = (double)onTable.total();
+	stage_profile.begin();
 
-	// Show skin filter ////////////////////////////////////////////////////////
-	imshow( WIN_SK, *gray_image );
-
-	// Erode ///////////////////////////////////////////////////////////////////
-	*el1 = getStructuringElement( MORPH_RECT, Size( 2*erosion_size + 1, 2*erosion_size+1 ), Point( erosion_size, erosion_size ) );
-	erode( *gray_image, *gray_image, *el1 );
+	// Between two detections the objects are moved by the follower ///////////
+	bool tracked = false;
+	if( follower && !follower->due() )
+	{
+		vector<Point2f> centers;
+		vector<Rect> boxes;
+		vector<double> areas;
+		int64 started = getTickCount();
+		tracked = follower->track( frameUnderTest, &centers, &boxes, &areas );
+
+		// Counted as the follower's, whether it succeeded or not
+		frame_costs.followMs += ( getTickCount() - started ) * 1000.0 / getTickFrequency();
+		frame_costs.followed++;
+		if( !tracked ) frame_costs.followFailed++;
+
+		// As the detector would report them, relative to the table
+		for( size_t i = 0; tracked && i < centers.size(); i++ )
+			found->push( (float)areas[i], Point2f( centers[i].x - crop.x, centers[i].y - crop.y ), boxes[i] - crop.tl(), -1 );
+		stage_profile.end( "follow", pixels );
+	}
 
-	// Dilate //////////////////////////////////////////////////////////////////
-	*el2 = getStructuringElement( MORPH_RECT, Size( 2*dilation_size + 1, 2*dilation_size+1 ), Point( dilation_size, dilation_size ) );
-	dilate( *gray_image, *gray_image, *el2 );
+	if( !tracked )
+	{
+		// The detector engine, on the table only
+		int64 started = getTickCount();
+		vector<Blob> blobs;
+		detector->detect( &onTable, gray_image, render ? skin : NULL, &blobs );
+		stage_profile.end( "detector", pixels );
+
+		// Areas + Mass Centers + Boxes, of the blobs big enough ///////////////
+		found->assign( &blobs, thresh_area );
+		outlines = detector->outlines();
+		stage_profile.end( "blob table", pixels );
+
+		frame_costs.detectMs += ( getTickCount() - started ) * 1000.0 / getTickFrequency();
+		frame_costs.detected++;
+	}
 
-	// Find contours ///////////////////////////////////////////////////////////
-	vector<vector<Point> > contours;
-	vector<Vec4i> hierarchy;
-	findContours( *gray_image, contours, hierarchy, CV_RETR_TREE, CV_CHAIN_APPROX_SIMPLE, Point(0, 0) );
+	// Back to frame coordinates, dropping what lies off the table ////////////
+	found->shift( crop.tl() );
+	if( table )
+	{
+		for( int i = 0; i < found->size(); i++ )
+			if( !table->contains( found->center(i) ) ) found->area[i] = 0;
+	}
 
-	// ApproxPoly + BoundingRect + Moments + Mass Centers //////////////////////
-	vector<vector<Point> > contours_poly( contours.size() );
-	vector<Rect> boundRect( contours.size() );
-	vector<Moments> mu(contours.size() );
-	vector<Point2f> mc( contours.size() );
+	// Select 2 contours, whose moments have the biggest area //////////////////
+	selectBiggest( firstidx, secondidx, found );
 
-	for( int i = 0; i < contours.size(); i++ )
+	// Identities //////////////////////////////////////////////////////////////
+	if( tracker )
 	{
-		// Discard contours with area < threshold
-		*area = contourArea( contours[i] );
-		if( *area > thresh_area )
+		// Every object is matched to its track, then the 2 selected ones are
+		// kept in the order they had, whatever their areas
+		vector<Point2f> centers;
+		vector<int> contour, ids;
+		for( int i = 0; i < found->size(); i++ )
 		{
-			// Approximate contours to polygons
-			approxPolyDP( Mat(contours[i]), contours_poly[i], 3, true );
-
-			// Get bounding rects
-			boundRect[i] = boundingRect( Mat(contours_poly[i]) );
-
-			// Get the moments
-			mu[i] = moments( contours_poly[i], false );
+			if( found->area[i] <= 0 ) continue;
+			centers.push_back( found->center(i) );
+			contour.push_back( i );
+		}
+		tracker->update( &centers, &ids );
 
-			// Get the mass centers
-			mc[i] = Point2f( mu[i].m10/mu[i].m00 , mu[i].m01/mu[i].m00 );
+		int id1 = -1, id2 = -1;
+		for( size_t j = 0; j < contour.size(); j++ )
+		{
+			if( contour[j] == *firstidx )  id1 = ids[j];
+			if( contour[j] == *secondidx ) id2 = ids[j];
 		}
+		if( tracker->swapSlots( id1, id2 ) ) std::swap( *firstidx, *secondidx );
 	}
+	stage_profile.end( "select", pixels );
 
-	// Select 2 contours, whose moments have the biggest area //////////////////
-	selectBiggest( firstidx, secondidx, &mu );
-
-
+	// A missing object points at an empty entry, at the origin
+	if( *firstidx < 0 || *secondidx < 0 )
+	{
+		found->push( 0, Point2f(), Rect(), -1 );
 
-	////////////////////////////////////////////////////////////////////////////
-	// Draw selected contours //////////////////////////////////////////////////
-	////////////////////////////////////////////////////////////////////////////
-	*objects = Mat::zeros( gray_image->size(), CV_8UC3 );
+		if( *firstidx < 0 )  *firstidx  = found->size() - 1;
+		if( *secondidx < 0 ) *secondidx = found->size() - 1;
+	}
 
-	// First object
-	drawContours( *objects, contours_poly, *firstidx, green, 2, 8, hierarchy, 0, Point() );
-	rectangle( *objects, boundRect[*firstidx].tl(), boundRect[*firstidx].br(), green, 2, 8, 0 );
-	circle( *objects, mc[*firstidx], 5, green, -1, 8, 0 );
+	// Hand the objects just detected to the follower
+	if( follower && !tracked )
+	{
+		vector<Point2f> centers;
+		vector<Rect> boxes;
+		vector<double> areas;
+		int selected[2] = { *firstidx, *secondidx };
+		for( int k = 0; k < 2; k++ )
+		{
+			if( found->area[ selected[k] ] <= 0 ) continue;
+			centers.push_back( found->center( selected[k] ) );
+			boxes.push_back( found->box( selected[k] ) );
+			areas.push_back( found->area[ selected[k] ] );
+		}
+		follower->seed( frameUnderTest, &boxes, &centers, &areas );
+	}
 
-	// Second object
-	drawContours( *objects, contours_poly, *secondidx, green, 2, 8, hierarchy, 0, Point() );
-	rectangle( *objects, boundRect[*secondidx].tl(), boundRect[*secondidx].br(), green, 2, 8, 0 );
-	circle( *objects, mc[*secondidx], 5, green, -1, 8, 0 );
+	// Centers /////////////////////////////////////////////////////////////////
+	*p1x = *p1y = *p2x = *p2y = 0;
+	if( found->area[*firstidx] > 0 )
+	{
+		*p1x = found->cx[*firstidx];
+		*p1y = found->cy[*firstidx];
+	}
+	if( found->area[*secondidx] > 0 )
+	{
+		*p2x = found->cx[*secondidx];
+		*p2y = found->cy[*secondidx];
+	}
 
-	// Show selected contours //////////////////////////////////////////////////
-	imshow( WIN_SQ, *objects );
+	// Report, written in batches by the results thread ////////////////////////
+	ResultRecord out = ResultRecord();
+	out.frame     = frameNum;
+	out.timestamp = timestamp;
+	out.x1        = found->cx[*firstidx];
+	out.y1        = found->cy[*firstidx];
+	out.x2        = found->cx[*secondidx];
+	out.y2        = found->cy[*secondidx];
+	out.dx        = abs( *p1x - *p2x );
+	out.dy        = abs( *p1y - *p2y );
+	out.distance  = sqrt( (float)( out.dx * out.dx + out.dy * out.dy ) );
+	if( found->area[*firstidx] > 0 && found->area[*secondidx] > 0 ) out.flags |= RESULT_FOUND;
+	if( render ) out.flags |= RESULT_DISPLAYED;
+	if( tracked ) out.flags |= RESULT_TRACKED;
+	results->push( out );
+
+	// Remember the path of both objects, only where they were found
+	if( found->area[*firstidx] > 0 )  trajectory->push( 0, frameNum, timestamp, found->center( *firstidx ) );
+	if( found->area[*secondidx] > 0 ) trajectory->push( 1, frameNum, timestamp, found->center( *secondidx ) );
+	stage_profile.end( "results", pixels );
 
 
 
 	////////////////////////////////////////////////////////////////////////////
-	// Draw tracking ///////////////////////////////////////////////////////////
+	// Hand over to the display ////////////////////////////////////////////////
 	////////////////////////////////////////////////////////////////////////////
-	if( *flag == 0 )
+	if( render )
 	{
-		// If it's the first iteration, clear the image
-		// otherwise update the tracking
-		*tracking = Mat::zeros( gray_image->size(), CV_8UC3 );
-		*flag = 1;
+		// The capture reuses its buffer, so the frame is copied; the skin view
+		// is given away and the next frame that needs it takes another buffer.
+		// Both buffers go back to the pool when the display is done with them
+		DisplayRecord record;
+		record.frameNum = frameNum;
+		record.timestamp = timestamp;
+		record.frame = pool->get( frameUnderTest->size(), frameUnderTest->type() );
+		frameUnderTest->copyTo( record.frame );
+		record.skin = *skin;
+		skin->release();
+
+		// Only the dense modes keep polygons; they are copied in frame coordinates
+		int selected[2] = { *firstidx, *secondidx };
+		for( int k = 0; outlines && k < 2; k++ )
+		{
+			int src = found->source[ selected[k] ];
+			if( src >= 0 && found->area[ selected[k] ] > 0 && !(*outlines)[src].empty() )
+				record.selected.append( (*outlines)[src], crop.tl() );
+		}
+		record.found1 = found->area[*firstidx] > 0;
+		record.found2 = found->area[*secondidx] > 0;
+		record.box1 = found->box( *firstidx );
+		record.box2 = found->box( *secondidx );
+		record.c1   = found->center( *firstidx );
+		record.c2   = found->center( *secondidx );
+		record.p1x  = *p1x;
+		record.p1y  = *p1y;
+		record.p2x  = *p2x;
+		record.p2y  = *p2y;
+		if( table && table->valid() ) record.table = table->polygon();
+
+		record.paths.resize( trajectory->objects() );
+		for( int o = 0; o < trajectory->objects(); o++ )
+			trajectory->recent( o, timestamp - trajectory_window, &record.paths[o] );
+
+		display->post( &record );
+		stage_profile.end( "display", pixels );
 	}
+}
 
-	// First center
-	*p1x = mu[*firstidx].m10/mu[*firstidx].m00;
-	*p1y = mu[*firstidx].m01/mu[*firstidx].m00;
-
-	circle( *tracking, mc[*firstidx], 5, green, -1, 8, 0 );
-	cout << " - Center: (" << *p1x << "," << *p1y << ")" << endl;
-
-
-	// Second center
-	*p2x = mu[*secondidx].m10/mu[*secondidx].m00;
-	*p2y = mu[*secondidx].m01/mu[*secondidx].m00;
 
-	circle( *tracking, mc[*secondidx], 5, green, -1, 8, 0 );
-	cout << " - Center: (" << *p2x << "," << *p2y << ")" << endl;
-	cout << "---" << endl;
 
-	// Show tracking ///////////////////////////////////////////////////////////
-	imshow( WIN_CT, *tracking );
+////////////////////////////////////////////////////////////////////////////////
+// WINDOWS /////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+void setupWindows( Size refS )
+{
+	// Frame under test
+	namedWindow( WIN_UT, CV_WINDOW_NORMAL );
+	cvMoveWindow( WIN_UT, 720, 0 );
+
+	// Skin filter
+	namedWindow( WIN_SK, CV_WINDOW_NORMAL );
+	cvMoveWindow( WIN_SK, refS.width, 0 );
+
+	// Selected contours
+	namedWindow( WIN_SQ, CV_WINDOW_NORMAL );
+	cvMoveWindow( WIN_SQ, 720, 300 );
+
+	// Tracking
+	namedWindow( WIN_CT, CV_WINDOW_NORMAL );
+	cvMoveWindow( WIN_CT, refS.width, 300 );
+
+	// Bar chart
+	namedWindow( WIN_CHART, CV_WINDOW_NORMAL );
+	cvMoveWindow( WIN_CHART, 490, 0 );
+	cvResizeWindow( WIN_CHART, 220, 450 );
+}
 
+void renderFrame( const DisplayRecord *record, TaskGraph *views, Mat *objects, Mat *tracking, Mat *chart )
+{
+	// Runs on the display thread. The views are drawn by the graph, but shown
+	// from this thread only, as highgui wants
 
+	views->run();
 
-	////////////////////////////////////////////////////////////////////////////
-	// Draw Bar Chart //////////////////////////////////////////////////////////
-	////////////////////////////////////////////////////////////////////////////
-	*distx = abs(*p1x - *p2x);
-	*disty = abs(*p1y - *p2y);
+	// Show original image and skin filter /////////////////////////////////////
+	imshow( WIN_UT, record->frame );
+	if( !record->skin.empty() ) imshow( WIN_SK, record->skin );
 
-	drawBarChart( chart, *tot_width, *tot_height, *p1x, *p1y, *p2x, *p2y, *distx, *disty );
+	// Show selected contours, tracking and bar chart //////////////////////////
+	imshow( WIN_SQ, *objects );
+	imshow( WIN_CT, *tracking );
+	imshow( WIN_CHART, *chart );
 }
 
 
 
 ////////////////////////////////////////////////////////////////////////////////
-// SKIN DETECTION //////////////////////////////////////////////////////////////
+// DRAW SELECTED CONTOURS //////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
-void skinPixels( Mat *imgBGR, Mat *imgSkin, Mat *imgHSV, vector<Mat> *hsv_planes, Mat *planeH, Mat *planeS, Mat *planeV )
+void drawObjects( const DisplayRecord *record, Mat *objects, Size refS )
 {
-	// Returns an image that is white in corrispondence of skin pixels, black elsewhere
+	objects->create( refS, CV_8UC3 );
+	objects->setTo( black );
 
-    // Convert the image to HSV colors
-	*imgHSV = Mat::zeros( imgBGR->size(), CV_8UC3 );
-	cvtColor( *imgBGR, *imgHSV, CV_BGR2HSV );
-
-	// Get the separate HSV color components of the color input image
-	split( *imgHSV, *hsv_planes );
-
-	*planeH = hsv_planes->at(0);      // Hue component
-	*planeS = hsv_planes->at(1);      // Saturation component
-	*planeV = hsv_planes->at(2);      // Brightness component
+	if( !record->table.empty() )
+	{
+		// Area being analyzed
+		const Point *pts = &record->table[0];
+		int n = (int)record->table.size();
+		polylines( *objects, &pts, &n, 1, true, blue, 1, 8 );
+	}
 
-    // Detect which pixels in each of the H, S and V channels are probably skin pixels
-    // Assume that skin has a Hue between 0 to 18 (out of 180), and Saturation above 50, and Brightness above 80
-    threshold( *planeH, *planeH, 18, 255, THRESH_BINARY_INV );
-    threshold( *planeS, *planeS, 50, 255, THRESH_BINARY_INV );
-    threshold( *planeV, *planeV, 80, 255, THRESH_BINARY_INV );
+	for( int i = 0; i < record->selected.size(); i++ )
+	{
+		PointSpan polygon = record->selected[i];
+		polylines( *objects, &polygon.points, &polygon.count, 1, true, green, 2, 8 );
+	}
 
-    // Combine all 3 thresholded color components
-    // so that an output pixel will only be white if the H, S and V pixels were also white
-    *imgSkin = Mat::zeros( imgHSV->size(), CV_8UC1 );  // Greyscale output image
-    bitwise_and( *planeH, *planeS, *imgSkin );		   // imageSkin = H {BITWISE_AND} S
-    bitwise_and( *imgSkin, *planeV, *imgSkin );		   // imageSkin = H {BITWISE_AND} S {BITWISE_AND} V
+	// First object
+	if( record->found1 )
+	{
+		rectangle( *objects, record->box1.tl(), record->box1.br(), green, 2, 8, 0 );
+		circle( *objects, record->c1, 5, green, -1, 8, 0 );
+	}
 
-    // Invert the resulting image
-    bitwise_not( *imgSkin, *imgSkin );
+	// Second object
+	if( record->found2 )
+	{
+		rectangle( *objects, record->box2.tl(), record->box2.br(), green, 2, 8, 0 );
+		circle( *objects, record->c2, 5, green, -1, 8, 0 );
+	}
 }
 
 
 
 ////////////////////////////////////////////////////////////////////////////////
-// SELECT BIGGEST //////////////////////////////////////////////////////////////
+// DRAW TRACKING ///////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
-void selectBiggest( int *firstidx, int *secondidx, vector<Moments> *mu )
+void drawTracking( const DisplayRecord *record, Mat *tracking, Size refS )
 {
-	// Returns the indexes of the 2 biggest contours of the image
+	tracking->create( refS, CV_8UC3 );
+	tracking->setTo( black );
 
-	*firstidx  = -1;
-	*secondidx = -1;
+	// Path of the last trajectory_window seconds, fading out with age
+	for( size_t o = 0; o < record->paths.size(); o++ )
+		drawFadingPath( tracking, &record->paths[o], record->timestamp, trajectory_window, green );
+}
 
-	float firstdim  = -1;
-	float seconddim = -1;
-	float temparea;
+void drawChart( const DisplayRecord *record, Mat *chart, BarChart *barChart, Size refS )
+{
+	int distx = abs( record->p1x - record->p2x );
+	int disty = abs( record->p1y - record->p2y );
 
-	// Init ////////////////////////////////////////////////////////////////////
-	if( mu->at(0).m00 > mu->at(1).m00 )
-	{
-		*firstidx = 0;
-		firstdim = mu->at(0).m00;
+	drawBarChart( chart, barChart, refS.width, refS.height, record->p1x, record->p1y, record->p2x, record->p2y, distx, disty );
+}
 
-		*secondidx = 1;
-		seconddim = mu->at(1).m00;;
-	}
-	else
-	{
-		*firstidx = 1;
-		firstdim = mu->at(1).m00;
 
-		*secondidx = 0;
-		seconddim = mu->at(0).m00;
-	}
 
+////////////////////////////////////////////////////////////////////////////////
+// SKIN DETECTION //////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+void skinPixels( Mat *imgBGR, Mat *mask )
+{
+	// Keeps the dark pixels of the thresholded mask only where Hue is up to 18
+	// (out of 180), Saturation up to 50 and Brightness up to 80. Only those
+	// pixels are converted to HSV: the white table between them is skipped
+	// 16 or 32 pixels at a time
 
-	// Iterate /////////////////////////////////////////////////////////////////
-	for( int i = 2; i < mu->size(); i++ )
-	{
-		temparea = mu->at(i).m00;
+	static const HsvTables hsv;
+	sparseSkinFilter( imgBGR, mask, &hsv, 18, 50, 80 );
+}
 
-		if( temparea > firstdim ) {
-			*secondidx = *firstidx;
-			seconddim = firstdim;
 
-			*firstidx = i;
-			firstdim = temparea;
-		}
-		else if( temparea > seconddim ) {
-			*secondidx = i;
-			seconddim = temparea;
-		}
-	}
+
+////////////////////////////////////////////////////////////////////////////////
+// SELECT BIGGEST //////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+void selectBiggest( int *firstidx, int *secondidx, const BlobTable *found )
+{
+	// Returns the indexes of the 2 biggest contours of the image, -1 where
+	// there are fewer than 2 contours with a positive area
+
+	vector<int> top;
+	selectTopK( &found->area, 2, &top );
+
+	*firstidx  = ( top.size() > 0 ) ? top[0] : -1;
+	*secondidx = ( top.size() > 1 ) ? top[1] : -1;
 }
 
 
@@ -417,29 +1073,24 @@ void selectBiggest( int *firstidx, int *secondidx, vector<Moments> *mu )
 ////////////////////////////////////////////////////////////////////////////////
 // DRAW BARCHART ///////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
-void drawBarChart(Mat *chart, int tot_width, int tot_height, int p1x, int p1y, int p2x, int p2y, int distx, int disty )
+void drawBarChart(Mat *chart, BarChart *barChart, int tot_width, int tot_height, int p1x, int p1y, int p2x, int p2y, int distx, int disty )
 {
+	// Axis and labels are cached by the chart, only the changed bars are redrawn
+	if( barChart->empty() )
+	{
+		barChart->addBar( 5,   40, peach,      "x1" );
+		barChart->addBar( 55,  40, bisque,     "y1" );
+		barChart->addBar( 155, 40, steel,      "x2" );
+		barChart->addBar( 205, 40, cadet,      "y2" );
+		barChart->addBar( 305, 40, orange,     "dx" );
+		barChart->addBar( 355, 40, darkorange, "dy" );
+	}
+
 	// Define size of the new image ////////////////////////////////////////////
 	int new_height;
 	if( tot_width > tot_height ) new_height = tot_width;
 	else new_height = tot_height;
 
-	// Reset Chart /////////////////////////////////////////////////////////////
-	*chart = Mat::zeros( Size(400, new_height+50), CV_8UC3 );
-
-	// Axis ////////////////////////////////////////////////////////////////////
-	line( *chart, Point(0, new_height), Point(400, new_height), red, 5, 8, 0 );
-
-	putText( *chart, "x1", Point(5,new_height+30), FONT_HERSHEY_TRIPLEX, 1, white, 1, 8, false );
-	putText( *chart, "y1", Point(55,new_height+30), FONT_HERSHEY_TRIPLEX, 1, white, 1, 8, false );
-
-	putText( *chart, "x2", Point(155,new_height+30), FONT_HERSHEY_TRIPLEX, 1, white, 1, 8, false );
-	putText( *chart, "y2", Point(205,new_height+30), FONT_HERSHEY_TRIPLEX, 1, white, 1, 8, false );
-
-	putText( *chart, "dx", Point(305,new_height+30), FONT_HERSHEY_TRIPLEX, 1, white, 1, 8, false );
-	putText( *chart, "dy", Point(355,new_height+30), FONT_HERSHEY_TRIPLEX, 1, white, 1, 8, false );
-
-
 	// Define object on left and right /////////////////////////////////////////
 	int x1,x2,y1,y2;
 	if( p1x < p2x)
@@ -459,18 +1110,7 @@ void drawBarChart(Mat *chart, int tot_width, int tot_height, int p1x, int p1y, i
 		y2 = p1y;
 	}
 
-	// Draw bars of P1 (left object) ///////////////////////////////////////////
-	rectangle( *chart, Point(5,new_height), Point(5+40,new_height-x1), peach, CV_FILLED, 8, 0 );
-	rectangle( *chart, Point(55,new_height), Point(55+40,new_height-y1), bisque, CV_FILLED, 8, 0 );
-
-	// Draw bars of P2 (right object) //////////////////////////////////////////
-	rectangle( *chart, Point(155,new_height), Point(155+40,new_height-x2), steel, CV_FILLED, 8, 0 );
-	rectangle( *chart, Point(205,new_height), Point(205+40,new_height-y2), cadet, CV_FILLED, 8, 0 );
-
-	// Draw bars of distance ///////////////////////////////////////////////////
-	rectangle( *chart, Point(305,new_height), Point(305+40,new_height-distx), orange, CV_FILLED, 8, 0 );
-	rectangle( *chart, Point(355,new_height), Point(355+40,new_height-disty), darkorange, CV_FILLED, 8, 0 );
-
-	// Show the bar chart
-	imshow( WIN_CHART, *chart );
+	// Draw bars of P1 (left object), P2 (right object) and distance ///////////
+	int values[6] = { x1, y1, x2, y2, distx, disty };
+	barChart->draw( chart, new_height, values );
 }